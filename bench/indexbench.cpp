@@ -0,0 +1,123 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../giscup/gis_segment.h"
+#include "../giscup/gis_segment_store.h"
+#include "../giscup/gis_index.h"
+#include "../giscup/gis_parse.h"
+
+using namespace std;
+
+/**
+ * Index backend comparison.  Builds every gis_index backend over the WA road
+ * network and reports build time, index memory and per-query latency.
+ *
+ * Usage: indexbench.exe <path to giscup_data> [queries]
+ *
+ * Query points are segment midpoints jittered by up to ~100m, which is
+ * roughly where GPS samples of a trajectory fall.
+ */
+
+#define BENCH_DEFAULT_QUERIES 100000
+#define BENCH_JITTER 0.001
+#define BENCH_RADIUS 0.0005
+#define BENCH_BOX 0.002
+
+double seconds_since(clock_t begin) {
+	return double(clock() - begin) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[]) {
+	vector<gis_segment> network(0);
+	vector<unsigned int> segmentids;
+	vector<double> querylat, querylon;
+	gis_segment_store store;
+	unsigned int queries = BENCH_DEFAULT_QUERIES;
+	gis_index_type types[] = { GIS_INDEX_QUADTREE, GIS_INDEX_GRID, GIS_INDEX_RTREE };
+	clock_t begin;
+
+	if (argc < 2) {
+		cout << "Usage: indexbench <path to giscup_data> [queries]" << endl;
+		return 1;
+	}
+	if (argc > 2) {
+		queries = atoi(argv[2]);
+	}
+
+	begin = clock();
+	parse_edge_geometry3(argv[1], network);
+	for (size_t i = 0; i < network.size(); i++) {
+		segmentids.push_back(store.add(network[i]));
+	}
+	cout << "Segments: " << network.size() << " (parsed in " << setprecision(4) << seconds_since(begin) << "s)" << endl;
+	if (network.empty()) {
+		return 1;
+	}
+
+	srand(2012);
+	for (unsigned int i = 0; i < queries; i++) {
+		const gis_segment &s = network[((size_t)rand() * RAND_MAX + rand()) % network.size()];
+		querylat.push_back((s.latitude1 + s.latitude2) / 2 + BENCH_JITTER * (2.0 * rand() / RAND_MAX - 1));
+		querylon.push_back((s.longitude1 + s.longitude2) / 2 + BENCH_JITTER * (2.0 * rand() / RAND_MAX - 1));
+	}
+
+	cout << left << setw(10) << "backend" << right
+		<< setw(10) << "build s" << setw(10) << "MB"
+		<< setw(12) << "knn1 us" << setw(12) << "knn8 us"
+		<< setw(12) << "radius us" << setw(12) << "box us"
+		<< setw(12) << "box hits" << endl;
+	for (int t = 0; t < 3; t++) {
+		vector<unsigned int> result;
+		double build, knn1, knn8, radius, box;
+		size_t hits = 0;
+		gis_index * index = gis_index::create(types[t], &store);
+
+		begin = clock();
+		index->build(segmentids);
+		build = seconds_since(begin);
+
+		begin = clock();
+		for (unsigned int i = 0; i < queries; i++) {
+			result.clear();
+			index->nearest(querylat[i], querylon[i], 1, result);
+		}
+		knn1 = seconds_since(begin);
+
+		begin = clock();
+		for (unsigned int i = 0; i < queries; i++) {
+			result.clear();
+			index->nearest(querylat[i], querylon[i], 8, result);
+		}
+		knn8 = seconds_since(begin);
+
+		begin = clock();
+		for (unsigned int i = 0; i < queries; i++) {
+			result.clear();
+			index->radius(querylat[i], querylon[i], BENCH_RADIUS, result);
+		}
+		radius = seconds_since(begin);
+
+		begin = clock();
+		for (unsigned int i = 0; i < queries; i++) {
+			result.clear();
+			index->box(querylat[i] - BENCH_BOX / 2, querylon[i] - BENCH_BOX / 2, querylat[i] + BENCH_BOX / 2, querylon[i] + BENCH_BOX / 2, result);
+			hits += result.size();
+		}
+		box = seconds_since(begin);
+
+		cout << left << setw(10) << index->name() << right << fixed << setprecision(3)
+			<< setw(10) << build
+			<< setw(10) << (index->memory_usage() / 1048576.0)
+			<< setw(12) << (knn1 * 1e6 / queries)
+			<< setw(12) << (knn8 * 1e6 / queries)
+			<< setw(12) << (radius * 1e6 / queries)
+			<< setw(12) << (box * 1e6 / queries)
+			<< setw(12) << hits << endl;
+		cout.unsetf(ios::fixed);
+		delete index;
+	}
+	return 0;
+}
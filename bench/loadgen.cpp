@@ -0,0 +1,220 @@
+#ifndef _WIN32
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../giscup/gis_trajectory.h"
+#include "../giscup/gis_trajectory_reader.h"
+#include "../giscup/gis_protocol.h"
+#include "../giscup/gis_parse.h"
+
+using namespace std;
+
+/**
+ * Load generator for the mapmatch server (mapmatch.exe <path to giscup_data>
+ * --serve <socket>).  Replays the training inputs, cut into requests of a
+ * few samples each, from several concurrent connections, and reports
+ * request latency percentiles and throughput.
+ *
+ * Usage: loadgen <socket> <path to giscup_data> [connections] [samples per request] [passes]
+ *
+ * Each connection sends a request and waits for its response before sending
+ * the next one, so the number of connections is the number of requests in
+ * flight for the server to batch.
+ */
+
+#define LOADGEN_DEFAULT_CONNECTIONS 16
+#define LOADGEN_DEFAULT_SAMPLES 32
+#define LOADGEN_DEFAULT_PASSES 1
+
+struct loadgen_request {
+	unsigned int trajectory;
+	size_t begin;
+	size_t end;
+};
+
+int connect_server(const char * path) {
+	struct sockaddr_un address;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1 || strlen(path) >= sizeof(address.sun_path)) {
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool send_all(int fd, const vector<char> &buffer) {
+	size_t sent = 0;
+	while (sent < buffer.size()) {
+		ssize_t count = write(fd, &buffer[sent], buffer.size() - sent);
+		if (count <= 0) {
+			return false;
+		}
+		sent += count;
+	}
+	return true;
+}
+
+/**
+ * Read until a whole response frame is buffered and decode it.  Bytes past
+ * the frame are kept in input for the next call.
+ */
+bool receive_response(int fd, vector<char> &input, unsigned int &requestid, gis_trajectory &result) {
+	char chunk[65536];
+	for (;;) {
+		long length = input.empty() ? 0 : gis_decode_response(&input[0], input.size(), requestid, result);
+		if (length < 0) {
+			return false;
+		}
+		if (length > 0) {
+			input.erase(input.begin(), input.begin() + length);
+			return true;
+		}
+		ssize_t count = read(fd, chunk, sizeof(chunk));
+		if (count <= 0) {
+			return false;
+		}
+		input.insert(input.end(), chunk, chunk + count);
+	}
+}
+
+void client(const char * path, const vector<gis_trajectory> &trajectory, const vector<loadgen_request> &request, atomic<size_t> &next, atomic<size_t> &failures, vector<double> &latency) {
+	vector<char> output, input;
+	gis_trajectory result;
+	int fd = connect_server(path);
+	if (fd == -1) {
+		failures++;
+		return;
+	}
+	for (;;) {
+		size_t index = next++;
+		unsigned int requestid;
+		if (index >= request.size()) {
+			break;
+		}
+		const loadgen_request &r = request[index];
+		output.clear();
+		gis_encode_request((unsigned int)index, trajectory[r.trajectory], r.begin, r.end, output);
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		if (!send_all(fd, output) || !receive_response(fd, input, requestid, result)) {
+			failures++;
+			break;
+		}
+		latency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count());
+		if (requestid != index || result.size() != r.end - r.begin) {
+			failures++;
+		}
+	}
+	close(fd);
+}
+
+double percentile(const vector<double> &sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	return sorted[min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+int main(int argc, char *argv[]) {
+	vector<gis_trajectory> trajectory;
+	vector<loadgen_request> request;
+	gis_trajectory_reader reader;
+	unsigned int connections = LOADGEN_DEFAULT_CONNECTIONS, samples = LOADGEN_DEFAULT_SAMPLES, passes = LOADGEN_DEFAULT_PASSES;
+	size_t totalsamples = 0;
+
+	if (argc < 3) {
+		cout << "Usage: loadgen <socket> <path to giscup_data> [connections] [samples per request] [passes]" << endl;
+		return 1;
+	}
+	if (argc > 3) {
+		connections = max(atoi(argv[3]), 1);
+	}
+	if (argc > 4) {
+		samples = max(atoi(argv[4]), 1);
+	}
+	if (argc > 5) {
+		passes = max(atoi(argv[5]), 1);
+	}
+
+	for (unsigned int n = 1; ; n++) {
+		char name[64];
+		string filename;
+		sprintf(name, "GisContestTrainingData/input/input_%02u.txt", n);
+		filename = gis_path_join(argv[2], name);
+		trajectory.push_back(gis_trajectory());
+		if (!reader.read(filename.c_str(), trajectory.back())) {
+			trajectory.pop_back();
+			break;
+		}
+	}
+	if (trajectory.empty()) {
+		cout << "No training inputs found" << endl;
+		return 1;
+	}
+	for (unsigned int pass = 0; pass < passes; pass++) {
+		for (unsigned int t = 0; t < trajectory.size(); t++) {
+			for (size_t begin = 0; begin < trajectory[t].size(); begin += samples) {
+				loadgen_request r;
+				r.trajectory = t;
+				r.begin = begin;
+				r.end = min(begin + samples, trajectory[t].size());
+				request.push_back(r);
+				totalsamples += r.end - r.begin;
+			}
+		}
+	}
+	cout << "Trajectories: " << trajectory.size() << ", requests: " << request.size() << ", samples: " << totalsamples << endl;
+
+	vector<vector<double> > latency(connections);
+	vector<thread> clients;
+	atomic<size_t> next(0), failures(0);
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	for (unsigned int i = 0; i < connections; i++) {
+		clients.push_back(thread(client, argv[1], cref(trajectory), cref(request), ref(next), ref(failures), ref(latency[i])));
+	}
+	for (unsigned int i = 0; i < connections; i++) {
+		clients[i].join();
+	}
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+	vector<double> all;
+	for (unsigned int i = 0; i < connections; i++) {
+		all.insert(all.end(), latency[i].begin(), latency[i].end());
+	}
+	sort(all.begin(), all.end());
+	cout << fixed << setprecision(1);
+	cout << "Completed: " << all.size() << " requests in " << setprecision(3) << elapsed << "s, failures: " << failures.load() << endl;
+	cout << setprecision(1);
+	cout << "Latency us: p50 " << percentile(all, 0.50) << ", p99 " << percentile(all, 0.99) << ", max " << (all.empty() ? 0 : all.back()) << endl;
+	cout << "Throughput: " << (all.size() / elapsed) << " requests/s, " << (totalsamples / elapsed) << " samples/s" << endl;
+	return failures.load() == 0 ? 0 : 1;
+}
+
+#else
+
+#include <iostream>
+
+int main(int argc, char *argv[]) {
+	std::cout << "loadgen needs Unix domain sockets and is not available on this platform" << std::endl;
+	return 1;
+}
+
+#endif
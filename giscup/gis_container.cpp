@@ -1,6 +1,10 @@
 #include <vector>
+#include <queue>
+#include <functional>
 #include "gis_segment.h"
+#include "gis_segment_store.h"
 #include "gis_container.h"
+#include "gis_index.h"
 
 using namespace std;
 
@@ -121,7 +125,7 @@ gis_container::~gis_container(void) {
  * When considered in binary, these values match the bitmask latitude and
  * longitude bits in the following formula: (latitude << 1) + longitude
  */
-void gis_container::get_quadrants(bool quadrant[4], double lat1, double lon1, double lat2, double lon2) {
+void gis_container::get_quadrants(bool quadrant[4], double lat1, double lon1, double lat2, double lon2) const {
 	double latmid, lonmid;
 	// Clear the quadrants
 	quadrant[0] = quadrant[1] = quadrant[2] = quadrant[3] = false;
@@ -204,7 +208,53 @@ void gis_container::get_quadrants(bool quadrant[4], double lat1, double lon1, do
 	}
 }
 
-void gis_container::add_segment(vector<gis_segment> * segment, unsigned int segmentid) {
+/**
+ * Create an empty leaf covering the [lat][lon] quadrant of this container.
+ */
+gis_container * gis_container::new_subcontainer(int lat, int lon) const {
+	double latmax, latmin, lonmax, lonmin;
+	double range;
+	gis_container * container;
+	range = (latitudemax - latitudemin) / 2;
+	if (lat == 0) {
+		latmax = latitudemax - range;
+		latmin = latitudemin;
+	}
+	else {
+		latmax = latitudemax;
+		latmin = latitudemax - range;
+	}
+	range = (longitudemax - longitudemin) / 2;
+	if (lon == 0) {
+		lonmax = longitudemax - range;
+		lonmin = longitudemin;
+	}
+	else {
+		lonmax = longitudemax;
+		lonmin = longitudemax - range;
+	}
+	container = new gis_container();
+	container->setdata(latitudemask >> 1, longitudemask >> 1, bitindex - 1, latmax, lonmax, latmin, lonmin);
+	return container;
+}
+
+/**
+ * Create an empty leaf covering the same box as this container.
+ */
+gis_container * gis_container::new_sibling(void) const {
+	gis_container * container = new gis_container();
+	container->setdata(latitudemask, longitudemask, bitindex, latitudemax, longitudemax, latitudemin, longitudemin);
+	return container;
+}
+
+bool gis_container::is_empty(void) const {
+	if (usesubcontainer) {
+		return false;
+	}
+	return (mysegmentids == 0) || mysegmentids->empty();
+}
+
+void gis_container::add_segment(const gis_segment_store * segment, unsigned int segmentid) {
 	int size;
 	if (usesubcontainer == false) {
 		// Try to insert the segment
@@ -213,7 +263,10 @@ void gis_container::add_segment(vector<gis_segment> * segment, unsigned int segm
 			mysegmentids = new vector<unsigned int>(0);
 		}
 		size = mysegmentids->size();
-		if (size >= GIS_CONTAINER_SEGMENT_THRESHOLD) {
+		// Once the bits run out the box cannot be split any further (e.g.
+		// more than the threshold of segments meet at a single node), so
+		// the leaf just keeps growing.
+		if (size >= GIS_CONTAINER_SEGMENT_THRESHOLD && bitindex > 0) {
 			// Switch the flag so that this process may be called recursively
 			usesubcontainer = true;
 			for (int i = 0; i < size; i++) {
@@ -234,33 +287,13 @@ void gis_container::add_segment(vector<gis_segment> * segment, unsigned int segm
 	else {
 		// Add the segment to all of the appropriate subcontainers
 		bool quadrant[4];
-		get_quadrants(quadrant, (*segment)[segmentid].latitude1, (*segment)[segmentid].longitude1, (*segment)[segmentid].latitude2, (*segment)[segmentid].longitude2); 
+		const gis_segment &s = (*segment)[segmentid];
+		get_quadrants(quadrant, s.latitude1, s.longitude1, s.latitude2, s.longitude2);
 		for (int lat = 0; lat < 2; lat++) {
 			for (int lon = 0; lon < 2; lon++) {
 				if (quadrant[(lat << 1) + lon]) {
 					if (subcontainer[lat][lon] == 0) {
-						double latmax, latmin, lonmax, lonmin;
-						double range;
-						range = (latitudemax - latitudemin) / 2;
-						if (lat == 0) {
-							latmax = latitudemax - range;
-							latmin = latitudemin;
-						}
-						else {
-							latmax = latitudemax;
-							latmin = latitudemax - range;
-						}
-						range = (longitudemax - longitudemin) / 2;
-						if (lon == 0) {
-							lonmax = longitudemax - range;
-							lonmin = longitudemin;
-						}
-						else {
-							lonmax = longitudemax;
-							lonmin = longitudemax - range;
-						}
-						subcontainer[lat][lon] = new gis_container();
-						subcontainer[lat][lon]->setdata(latitudemask >> 1, longitudemask >> 1, bitindex - 1, latmax, lonmax, latmin, lonmin);
+						subcontainer[lat][lon] = new_subcontainer(lat, lon);
 					}
 					subcontainer[lat][lon]->add_segment(segment, segmentid);
 				}
@@ -268,3 +301,238 @@ void gis_container::add_segment(vector<gis_segment> * segment, unsigned int segm
 		}
 	}
 }
+
+/**
+ * Copy-on-write insert.  This container is left untouched and retired; the
+ * returned container is a new copy of it that holds the segment.  Only the
+ * nodes on the path(s) to the leaves receiving the segment are copied, so the
+ * cost is O(depth) per quadrant crossed.  Newly created nodes are private
+ * until the caller publishes the returned root, so they are filled in place
+ * with add_segment().
+ */
+gis_container * gis_container::insert_segment(const gis_segment_store * segment, unsigned int segmentid, gis_epoch &epoch) {
+	gis_container * copy = new_sibling();
+	if (usesubcontainer == false) {
+		// Rebuild the leaf; add_segment() splits it if it overflows
+		if (mysegmentids != 0) {
+			for (size_t i = 0; i < mysegmentids->size(); i++) {
+				copy->add_segment(segment, (*mysegmentids)[i]);
+			}
+		}
+		copy->add_segment(segment, segmentid);
+	}
+	else {
+		bool quadrant[4];
+		const gis_segment &s = (*segment)[segmentid];
+		get_quadrants(quadrant, s.latitude1, s.longitude1, s.latitude2, s.longitude2);
+		copy->usesubcontainer = true;
+		for (int lat = 0; lat < 2; lat++) {
+			for (int lon = 0; lon < 2; lon++) {
+				if (!quadrant[(lat << 1) + lon]) {
+					// Share the untouched subtree
+					copy->subcontainer[lat][lon] = subcontainer[lat][lon];
+				}
+				else if (subcontainer[lat][lon] == 0) {
+					copy->subcontainer[lat][lon] = new_subcontainer(lat, lon);
+					copy->subcontainer[lat][lon]->add_segment(segment, segmentid);
+				}
+				else {
+					copy->subcontainer[lat][lon] = subcontainer[lat][lon]->insert_segment(segment, segmentid, epoch);
+				}
+			}
+		}
+	}
+	epoch.retire(this, release);
+	return copy;
+}
+
+/**
+ * Copy-on-write removal.  Returns this container unchanged if the segment is
+ * not stored below it; otherwise this container is retired and a new copy
+ * without the segment is returned.  Subcontainers that become empty are
+ * dropped, but partially emptied quadrants are not merged back into a leaf.
+ */
+gis_container * gis_container::remove_segment(const gis_segment_store * segment, unsigned int segmentid, gis_epoch &epoch) {
+	gis_container * copy;
+	if (usesubcontainer == false) {
+		if (mysegmentids == 0) {
+			return this;
+		}
+		size_t size = mysegmentids->size(), found = size;
+		for (size_t i = 0; i < size; i++) {
+			if ((*mysegmentids)[i] == segmentid) {
+				found = i;
+				break;
+			}
+		}
+		if (found == size) {
+			return this;
+		}
+		copy = new_sibling();
+		copy->mysegmentids = new vector<unsigned int>(0);
+		copy->mysegmentids->reserve(size - 1);
+		for (size_t i = 0; i < size; i++) {
+			if (i != found) {
+				copy->mysegmentids->push_back((*mysegmentids)[i]);
+			}
+		}
+	}
+	else {
+		bool quadrant[4], changed = false, empty = true;
+		gis_container * replacement[2][2];
+		const gis_segment &s = (*segment)[segmentid];
+		get_quadrants(quadrant, s.latitude1, s.longitude1, s.latitude2, s.longitude2);
+		for (int lat = 0; lat < 2; lat++) {
+			for (int lon = 0; lon < 2; lon++) {
+				replacement[lat][lon] = subcontainer[lat][lon];
+				if (quadrant[(lat << 1) + lon] && subcontainer[lat][lon] != 0) {
+					replacement[lat][lon] = subcontainer[lat][lon]->remove_segment(segment, segmentid, epoch);
+					if (replacement[lat][lon] != subcontainer[lat][lon]) {
+						changed = true;
+						if (replacement[lat][lon]->is_empty()) {
+							// Never published, so it can go right away
+							release(replacement[lat][lon]);
+							replacement[lat][lon] = 0;
+						}
+					}
+				}
+				if (replacement[lat][lon] != 0) {
+					empty = false;
+				}
+			}
+		}
+		if (!changed) {
+			return this;
+		}
+		copy = new_sibling();
+		if (!empty) {
+			copy->usesubcontainer = true;
+			for (int lat = 0; lat < 2; lat++) {
+				for (int lon = 0; lon < 2; lon++) {
+					copy->subcontainer[lat][lon] = replacement[lat][lon];
+				}
+			}
+		}
+	}
+	epoch.retire(this, release);
+	return copy;
+}
+
+/**
+ * Append the ids stored in every leaf overlapping the box.  A segment that
+ * crosses several of those leaves is appended once per leaf.
+ */
+void gis_container::find_segments_in_box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const {
+	if (latmax < latitudemin || latmin > latitudemax || lonmax < longitudemin || lonmin > longitudemax) {
+		return;
+	}
+	if (usesubcontainer) {
+		for (int lat = 0; lat < 2; lat++) {
+			for (int lon = 0; lon < 2; lon++) {
+				if (subcontainer[lat][lon] != 0) {
+					subcontainer[lat][lon]->find_segments_in_box(latmin, lonmin, latmax, lonmax, result);
+				}
+			}
+		}
+	}
+	else if (mysegmentids != 0) {
+		result.insert(result.end(), mysegmentids->begin(), mysegmentids->end());
+	}
+}
+
+/**
+ * Best-first k-nearest search.  Containers and segments share one queue
+ * ordered by distance: a container is keyed by the distance to its box, a
+ * segment by its exact distance, so a segment popped off the queue is closer
+ * than anything not yet examined.  Segments stored in several leaves are
+ * reported the first time they are popped.
+ */
+void gis_container::find_nearest(const gis_segment_store * segment, double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const {
+	struct candidate {
+		double distance;
+		const gis_container * container;
+		unsigned int segmentid;
+		bool operator>(const candidate &other) const {
+			return distance > other.distance;
+		}
+	};
+	priority_queue<candidate, vector<candidate>, greater<candidate> > queue;
+	size_t begin = result.size();
+	candidate c;
+
+	c.distance = 0;
+	c.container = this;
+	c.segmentid = 0;
+	queue.push(c);
+	while (!queue.empty() && result.size() - begin < k) {
+		c = queue.top();
+		queue.pop();
+		if (c.container == 0) {
+			bool reported = false;
+			for (size_t i = begin; i < result.size(); i++) {
+				if (result[i] == c.segmentid) {
+					reported = true;
+					break;
+				}
+			}
+			if (!reported) {
+				result.push_back(c.segmentid);
+			}
+		}
+		else if (c.container->usesubcontainer) {
+			for (int lat = 0; lat < 2; lat++) {
+				for (int lon = 0; lon < 2; lon++) {
+					const gis_container * child = c.container->subcontainer[lat][lon];
+					if (child != 0) {
+						candidate next;
+						next.distance = gis_box_distance(latitude, longitude, child->latitudemin, child->longitudemin, child->latitudemax, child->longitudemax);
+						next.container = child;
+						next.segmentid = 0;
+						queue.push(next);
+					}
+				}
+			}
+		}
+		else if (c.container->mysegmentids != 0) {
+			for (size_t i = 0; i < c.container->mysegmentids->size(); i++) {
+				candidate next;
+				next.segmentid = (*c.container->mysegmentids)[i];
+				next.distance = (*segment)[next.segmentid].distance(latitude, longitude);
+				next.container = 0;
+				queue.push(next);
+			}
+		}
+	}
+}
+
+/**
+ * Bytes held by this container and everything below it.
+ */
+size_t gis_container::memory_usage(void) const {
+	size_t bytes = sizeof(gis_container);
+	if (mysegmentids != 0) {
+		bytes += sizeof(vector<unsigned int>) + mysegmentids->capacity() * sizeof(unsigned int);
+	}
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			if (subcontainer[i][j] != 0) {
+				bytes += subcontainer[i][j]->memory_usage();
+			}
+		}
+	}
+	return bytes;
+}
+
+void gis_container::release(void * container) {
+	gis_container * c = (gis_container *)container;
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			c->subcontainer[i][j] = 0;
+		}
+	}
+	delete c;
+}
+
+void gis_container::destroy(void * container) {
+	delete (gis_container *)container;
+}
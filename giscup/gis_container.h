@@ -2,20 +2,46 @@
 
 #include <vector>
 #include "gis_segment.h"
+#include "gis_segment_store.h"
+#include "gis_epoch.h"
 
 using namespace std;
 
 #define GIS_CONTAINER_SEGMENT_THRESHOLD 30
 
+/**
+ * class gis_container
+ * PR-quadtree node.  Leaves hold up to GIS_CONTAINER_SEGMENT_THRESHOLD segment
+ * ids; a segment crossing several quadrants is stored in each of them.
+ *
+ * add_segment() mutates the tree in place and may only be used on a tree
+ * that no reader can see yet (e.g. while bulk loading).  Once a tree is
+ * published, use insert_segment() and remove_segment(), which leave the
+ * current tree untouched and return the root of a new version that shares
+ * every unchanged subtree with it.  Nodes replaced along the way are handed
+ * to the epoch for reclamation with release().
+ */
 class gis_container
 {
 public:
 	gis_container(void);
 	void setdata(unsigned long latitudemask, unsigned long longitudemask, unsigned int bitindex, double latitudemax, double longitudemax, double latitudemin, double longitudemin);
 	~gis_container(void);
-	void add_segment(vector<gis_segment> * segment, unsigned int segmentid);
-	void get_quadrants(bool quadrant[4], double lat1, double lon1, double lat2, double lon2);
+	void add_segment(const gis_segment_store * segment, unsigned int segmentid);
+	gis_container * insert_segment(const gis_segment_store * segment, unsigned int segmentid, gis_epoch &epoch);
+	gis_container * remove_segment(const gis_segment_store * segment, unsigned int segmentid, gis_epoch &epoch);
+	void find_segments_in_box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const;
+	void find_nearest(const gis_segment_store * segment, double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const;
+	size_t memory_usage(void) const;
+	void get_quadrants(bool quadrant[4], double lat1, double lon1, double lat2, double lon2) const;
+	// Delete a single node, leaving its (shared) subcontainers alone
+	static void release(void * container);
+	// Delete a node and everything below it
+	static void destroy(void * container);
 private:
+	gis_container * new_subcontainer(int lat, int lon) const;
+	gis_container * new_sibling(void) const;
+	bool is_empty(void) const;
 	vector<unsigned int> * mysegmentids;
 	gis_container * subcontainer[2][2];
 	unsigned long latitudemask;
@@ -27,4 +53,3 @@ private:
 	double latitudemin;
 	double longitudemin;
 };
-
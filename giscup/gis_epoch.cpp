@@ -0,0 +1,64 @@
+#include <stdexcept>
+#include "gis_epoch.h"
+
+gis_epoch::gis_epoch(void) {
+	globalepoch.store(1);
+	for (int i = 0; i < GIS_EPOCH_MAX_READERS; i++) {
+		readerepoch[i].store(0);
+	}
+}
+
+gis_epoch::~gis_epoch(void) {
+	for (size_t i = 0; i < retiredobjects.size(); i++) {
+		retiredobjects[i].reclaim(retiredobjects[i].object);
+	}
+}
+
+unsigned int gis_epoch::enter(void) {
+	for (unsigned int slot = 0; slot < GIS_EPOCH_MAX_READERS; slot++) {
+		unsigned long expected = 0;
+		// A stale epoch here only delays reclamation; it never makes it
+		// unsafe.
+		if (readerepoch[slot].compare_exchange_strong(expected, globalepoch.load())) {
+			return slot;
+		}
+	}
+	// Waiting for a slot could deadlock a thread that already holds one
+	throw length_error("gis_epoch has no free reader slot");
+}
+
+void gis_epoch::exit(unsigned int slot) {
+	readerepoch[slot].store(0);
+}
+
+void gis_epoch::retire(void * object, void (*reclaim)(void *)) {
+	retired_object entry;
+	entry.object = object;
+	entry.reclaim = reclaim;
+	entry.epoch = globalepoch.load();
+	retiredobjects.push_back(entry);
+}
+
+void gis_epoch::advance(void) {
+	unsigned long oldest;
+	size_t kept = 0;
+
+	oldest = globalepoch.fetch_add(1) + 1;
+	for (int i = 0; i < GIS_EPOCH_MAX_READERS; i++) {
+		unsigned long epoch = readerepoch[i].load();
+		if (epoch != 0 && epoch < oldest) {
+			oldest = epoch;
+		}
+	}
+	// Anything retired before the oldest active reader entered is no longer
+	// reachable by any reader.
+	for (size_t i = 0; i < retiredobjects.size(); i++) {
+		if (retiredobjects[i].epoch < oldest) {
+			retiredobjects[i].reclaim(retiredobjects[i].object);
+		}
+		else {
+			retiredobjects[kept++] = retiredobjects[i];
+		}
+	}
+	retiredobjects.resize(kept);
+}
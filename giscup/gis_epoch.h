@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+// Snapshots that may be open at once; enter() throws once all are taken
+#define GIS_EPOCH_MAX_READERS 64
+
+/**
+ * class gis_epoch
+ * Epoch-based reclamation for structures that are published by a single
+ * writer and read without locks.
+ *
+ * A reader calls enter() before loading the published pointer and exit()
+ * once it no longer touches anything reachable from it.  enter() records the
+ * global epoch in a free reader slot.
+ *
+ * The writer publishes a new version, retire()s every object the new version
+ * no longer references, and then calls advance().  Retired objects are tagged
+ * with the epoch in which they were retired and are only reclaimed once every
+ * active reader has entered a later epoch, i.e. once no reader can still be
+ * holding the old version.
+ *
+ * All atomics use sequentially consistent ordering: a reader that entered
+ * too late to be seen by advance() is guaranteed to load the new version.
+ */
+class gis_epoch {
+public:
+	gis_epoch(void);
+	// Reclaims every object still waiting to be reclaimed
+	~gis_epoch(void);
+	// Reader side: claim a slot, returns the slot to be passed to exit().
+	// Throws length_error if all GIS_EPOCH_MAX_READERS slots are in use.
+	unsigned int enter(void);
+	void exit(unsigned int slot);
+	// Writer side: queue an object to be passed to reclaim() once it is safe
+	void retire(void * object, void (*reclaim)(void *));
+	// Writer side: open a new epoch and reclaim what no reader can still see
+	void advance(void);
+private:
+	struct retired_object {
+		void * object;
+		void (*reclaim)(void *);
+		unsigned long epoch;
+	};
+	gis_epoch(const gis_epoch &);
+	gis_epoch & operator=(const gis_epoch &);
+	atomic<unsigned long> globalepoch;
+	// 0 marks a free slot, so epochs start at 1
+	atomic<unsigned long> readerepoch[GIS_EPOCH_MAX_READERS];
+	vector<retired_object> retiredobjects;
+};
@@ -0,0 +1,193 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "gis_grid_index.h"
+
+using namespace std;
+
+gis_grid_index::gis_grid_index(const gis_segment_store * segment) : gis_index(segment) {
+	latitudemin = longitudemin = 0;
+	cellsize = 1;
+	rows = columns = 1;
+	cellstart.assign(2, 0);
+}
+
+gis_grid_index::~gis_grid_index(void) {
+}
+
+const char * gis_grid_index::name(void) const {
+	return "grid";
+}
+
+int gis_grid_index::row(double latitude) const {
+	int r = (int)floor((latitude - latitudemin) / cellsize);
+	return r < 0 ? 0 : (r >= rows ? rows - 1 : r);
+}
+
+int gis_grid_index::column(double longitude) const {
+	int c = (int)floor((longitude - longitudemin) / cellsize);
+	return c < 0 ? 0 : (c >= columns ? columns - 1 : c);
+}
+
+void gis_grid_index::build(const vector<unsigned int> &segmentids) {
+	double latitudemax, longitudemax, width, height;
+	size_t cells;
+	if (segmentids.empty()) {
+		return;
+	}
+
+	// Size the grid to the extent of the data
+	latitudemin = longitudemin = 1e300;
+	latitudemax = longitudemax = -1e300;
+	for (size_t i = 0; i < segmentids.size(); i++) {
+		const gis_segment &s = (*segment)[segmentids[i]];
+		latitudemin = min(latitudemin, min(s.latitude1, s.latitude2));
+		latitudemax = max(latitudemax, max(s.latitude1, s.latitude2));
+		longitudemin = min(longitudemin, min(s.longitude1, s.longitude2));
+		longitudemax = max(longitudemax, max(s.longitude1, s.longitude2));
+	}
+	height = max(latitudemax - latitudemin, 1e-9);
+	width = max(longitudemax - longitudemin, 1e-9);
+	cells = min(max(segmentids.size() / GIS_GRID_SEGMENTS_PER_CELL, (size_t)1), (size_t)GIS_GRID_MAX_CELLS);
+	cellsize = sqrt(width * height / cells);
+	rows = max((int)ceil(height / cellsize), 1);
+	columns = max((int)ceil(width / cellsize), 1);
+	// Rounding up can only add a row and a column beyond the cap
+	while ((size_t)rows * columns > GIS_GRID_MAX_CELLS) {
+		cellsize *= 1.25;
+		rows = max((int)ceil(height / cellsize), 1);
+		columns = max((int)ceil(width / cellsize), 1);
+	}
+
+	// Two passes: count the entries of each cell, then fill them in
+	cellstart.assign((size_t)rows * columns + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		vector<unsigned int> fill;
+		if (pass == 1) {
+			for (size_t c = 1; c < cellstart.size(); c++) {
+				cellstart[c] += cellstart[c - 1];
+			}
+			cellsegments.resize(cellstart.back());
+			fill.assign(cellstart.begin(), cellstart.end() - 1);
+		}
+		for (size_t i = 0; i < segmentids.size(); i++) {
+			const gis_segment &s = (*segment)[segmentids[i]];
+			int r1 = row(min(s.latitude1, s.latitude2)), r2 = row(max(s.latitude1, s.latitude2));
+			int c1 = column(min(s.longitude1, s.longitude2)), c2 = column(max(s.longitude1, s.longitude2));
+			for (int r = r1; r <= r2; r++) {
+				for (int c = c1; c <= c2; c++) {
+					size_t cell = (size_t)r * columns + c;
+					if (pass == 0) {
+						cellstart[cell + 1]++;
+					}
+					else {
+						cellsegments[fill[cell]++] = segmentids[i];
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Ring search outwards from the cell containing the point.  After ring r is
+ * scanned every unscanned cell lies outside the (2r + 1) x (2r + 1) block
+ * around it, so the search stops once the k-th best distance is no larger
+ * than the distance from the point to the edge of that block.
+ */
+void gis_grid_index::nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const {
+	vector<pair<double, unsigned int> > best;
+	int r0, c0;
+	if (k == 0 || cellsegments.empty()) {
+		return;
+	}
+	r0 = row(latitude);
+	c0 = column(longitude);
+	for (int ring = 0; ; ring++) {
+		bool covered = true;
+		double bound = 1e300;
+		for (int r = r0 - ring; r <= r0 + ring; r++) {
+			if (r < 0 || r >= rows) {
+				continue;
+			}
+			// Only the outline of the block is new in this ring
+			int step = (r == r0 - ring || r == r0 + ring) ? 1 : 2 * ring;
+			for (int c = c0 - ring; c <= c0 + ring; c += step) {
+				if (c < 0 || c >= columns) {
+					continue;
+				}
+				size_t cell = (size_t)r * columns + c;
+				for (unsigned int i = cellstart[cell]; i < cellstart[cell + 1]; i++) {
+					unsigned int id = cellsegments[i];
+					double distance = (*segment)[id].distance(latitude, longitude);
+					if (best.size() == k && distance >= best.back().first) {
+						continue;
+					}
+					bool duplicate = false;
+					for (size_t j = 0; j < best.size(); j++) {
+						if (best[j].second == id) {
+							duplicate = true;
+							break;
+						}
+					}
+					if (duplicate) {
+						continue;
+					}
+					if (best.size() == k) {
+						best.pop_back();
+					}
+					best.insert(upper_bound(best.begin(), best.end(), make_pair(distance, id)), make_pair(distance, id));
+				}
+			}
+		}
+		// Sides of the block that reach the edge of the grid have nothing beyond them
+		if (r0 - ring > 0) {
+			covered = false;
+			bound = min(bound, latitude - (latitudemin + (r0 - ring) * cellsize));
+		}
+		if (r0 + ring < rows - 1) {
+			covered = false;
+			bound = min(bound, (latitudemin + (r0 + ring + 1) * cellsize) - latitude);
+		}
+		if (c0 - ring > 0) {
+			covered = false;
+			bound = min(bound, longitude - (longitudemin + (c0 - ring) * cellsize));
+		}
+		if (c0 + ring < columns - 1) {
+			covered = false;
+			bound = min(bound, (longitudemin + (c0 + ring + 1) * cellsize) - longitude);
+		}
+		if (covered || (best.size() == k && best.back().first <= bound)) {
+			break;
+		}
+	}
+	for (size_t i = 0; i < best.size(); i++) {
+		result.push_back(best[i].second);
+	}
+}
+
+void gis_grid_index::box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const {
+	size_t begin = result.size(), kept = begin;
+	if (cellsegments.empty()) {
+		return;
+	}
+	int r1 = row(latmin), r2 = row(latmax), c1 = column(lonmin), c2 = column(lonmax);
+	for (int r = r1; r <= r2; r++) {
+		for (int c = c1; c <= c2; c++) {
+			size_t cell = (size_t)r * columns + c;
+			result.insert(result.end(), cellsegments.begin() + cellstart[cell], cellsegments.begin() + cellstart[cell + 1]);
+		}
+	}
+	sort(result.begin() + begin, result.end());
+	result.erase(unique(result.begin() + begin, result.end()), result.end());
+	for (size_t i = begin; i < result.size(); i++) {
+		if ((*segment)[result[i]].intersects_box(latmin, lonmin, latmax, lonmax)) {
+			result[kept++] = result[i];
+		}
+	}
+	result.resize(kept);
+}
+
+size_t gis_grid_index::memory_usage(void) const {
+	return sizeof(gis_grid_index) + (cellstart.capacity() + cellsegments.capacity()) * sizeof(unsigned int);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include "gis_index.h"
+
+using namespace std;
+
+// Average number of segments per cell the grid is sized for
+#define GIS_GRID_SEGMENTS_PER_CELL 8
+#define GIS_GRID_MAX_CELLS (1 << 24)
+
+/**
+ * class gis_grid_index
+ * gis_index backed by a uniform grid of square cells spanning the bounding
+ * box of the indexed segments.  Each segment is listed in every cell its
+ * bounding box overlaps.  Cell lists are packed into a single array
+ * (cellstart[c] .. cellstart[c + 1] - 1 holds the ids of cell c).
+ */
+class gis_grid_index : public gis_index {
+public:
+	gis_grid_index(const gis_segment_store * segment);
+	~gis_grid_index(void);
+	const char * name(void) const;
+	void build(const vector<unsigned int> &segmentids);
+	void nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const;
+	void box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const;
+	size_t memory_usage(void) const;
+private:
+	int row(double latitude) const;
+	int column(double longitude) const;
+	double latitudemin;
+	double longitudemin;
+	double cellsize;
+	int rows;
+	int columns;
+	vector<unsigned int> cellstart;
+	vector<unsigned int> cellsegments;
+};
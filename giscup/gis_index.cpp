@@ -0,0 +1,53 @@
+#include <vector>
+#include "gis_index.h"
+#include "gis_quadtree_index.h"
+#include "gis_grid_index.h"
+#include "gis_rtree_index.h"
+
+using namespace std;
+
+gis_index::gis_index(const gis_segment_store * segment) {
+	gis_index::segment = segment;
+}
+
+gis_index::~gis_index(void) {
+}
+
+gis_index * gis_index::create(gis_index_type type, const gis_segment_store * segment) {
+	switch (type) {
+	case GIS_INDEX_GRID:
+		return new gis_grid_index(segment);
+	case GIS_INDEX_RTREE:
+		return new gis_rtree_index(segment);
+	case GIS_INDEX_QUADTREE:
+	default:
+		return new gis_quadtree_index(segment);
+	}
+}
+
+void gis_index::destroy(void * index) {
+	delete (gis_index *)index;
+}
+
+/**
+ * Default radius query: a box query on the circle's bounding box, filtered
+ * down to the segments that actually come within the distance.
+ */
+void gis_index::radius(double latitude, double longitude, double distance, vector<unsigned int> &result) const {
+	size_t begin = result.size(), kept = begin;
+	box(latitude - distance, longitude - distance, latitude + distance, longitude + distance, result);
+	for (size_t i = begin; i < result.size(); i++) {
+		if ((*segment)[result[i]].distance(latitude, longitude) <= distance) {
+			result[kept++] = result[i];
+		}
+	}
+	result.resize(kept);
+}
+
+gis_index * gis_index::insert_segment(unsigned int, gis_epoch &) {
+	return 0;
+}
+
+gis_index * gis_index::remove_segment(unsigned int, gis_epoch &) {
+	return 0;
+}
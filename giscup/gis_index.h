@@ -0,0 +1,78 @@
+#pragma once
+
+#include <math.h>
+#include <vector>
+#include "gis_segment.h"
+#include "gis_segment_store.h"
+#include "gis_epoch.h"
+
+using namespace std;
+
+enum gis_index_type {
+	GIS_INDEX_QUADTREE,
+	GIS_INDEX_GRID,
+	GIS_INDEX_RTREE
+};
+
+/**
+ * class gis_index
+ * Spatial index over segment ids of a gis_segment_store.  Every backend
+ * answers the same queries so that gis_map (and the index benchmark) can
+ * switch between them:
+ *   nearest() - the k segments closest to a point, closest first
+ *   radius()  - segments within a distance of a point, in no particular order
+ *   box()     - segments passing through a box, in no particular order
+ * Distances are planar, in degrees (see gis_segment::distance).  Each id is
+ * reported at most once per query, even by backends that store a segment in
+ * several places.
+ *
+ * A built index is read-only.  insert_segment() and remove_segment() return
+ * a new version of the index, retiring through the epoch whatever the old
+ * version does not share with it (including the old version itself).
+ * Backends that cannot be updated incrementally return 0, and the caller
+ * rebuilds instead.
+ */
+class gis_index {
+public:
+	gis_index(const gis_segment_store * segment);
+	virtual ~gis_index(void);
+	static gis_index * create(gis_index_type type, const gis_segment_store * segment);
+	// Reclaim function for gis_epoch::retire
+	static void destroy(void * index);
+
+	virtual const char * name(void) const = 0;
+	// Build over the given ids; may only be called once, on an empty index
+	virtual void build(const vector<unsigned int> &segmentids) = 0;
+	virtual void nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const = 0;
+	virtual void radius(double latitude, double longitude, double distance, vector<unsigned int> &result) const;
+	virtual void box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const = 0;
+	// Approximate bytes held by the index structure (not the segments)
+	virtual size_t memory_usage(void) const = 0;
+	virtual gis_index * insert_segment(unsigned int segmentid, gis_epoch &epoch);
+	virtual gis_index * remove_segment(unsigned int segmentid, gis_epoch &epoch);
+protected:
+	const gis_segment_store * segment;
+private:
+	gis_index(const gis_index &);
+	gis_index & operator=(const gis_index &);
+};
+
+/**
+ * Planar distance from (lat, lon) to the closest point of a box, 0 inside it.
+ */
+inline double gis_box_distance(double lat, double lon, double latmin, double lonmin, double latmax, double lonmax) {
+	double dlat = 0, dlon = 0;
+	if (lat < latmin) {
+		dlat = latmin - lat;
+	}
+	else if (lat > latmax) {
+		dlat = lat - latmax;
+	}
+	if (lon < lonmin) {
+		dlon = lonmin - lon;
+	}
+	else if (lon > lonmax) {
+		dlon = lon - lonmax;
+	}
+	return sqrt(dlat * dlat + dlon * dlon);
+}
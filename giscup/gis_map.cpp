@@ -35,23 +35,104 @@ unsigned long lon2index(double longitude) {
 	return (unsigned long)((longitude + 180) / 360 * 4294967295);
 }
 
-gis_map::gis_map(void) {
-	container.setdata(1 << 31, 1 << 31, 32, 90, 180, -90, -180);
+gis_map::gis_map(gis_index_type type) {
+	gis_map::type = type;
+	index.store(gis_index::create(type, &segment));
 }
 
 
 gis_map::~gis_map(void) {
+	delete index.load();
+}
+
+/**
+ * Build a fresh index over every live segment.  The current version is
+ * retired whole.
+ */
+gis_index * gis_map::rebuild(void) {
+	vector<unsigned int> segmentids;
+	gis_index * updated = gis_index::create(type, &segment);
+	for (unsigned int i = 0; i < live.size(); i++) {
+		if (live[i]) {
+			segmentids.push_back(i);
+		}
+	}
+	updated->build(segmentids);
+	epoch.retire(index.load(), gis_index::destroy);
+	return updated;
+}
+
+/**
+ * Swap in a new index version and reclaim whatever the previous versions no
+ * longer share with it.  Must be called with the writer mutex held, after
+ * the replaced objects have been retired.
+ */
+void gis_map::publish(gis_index * updated) {
+	index.store(updated);
+	epoch.advance();
+}
+
+void gis_map::add_segments(const vector<gis_segment> &segments) {
+	lock_guard<mutex> lock(writer);
+	for (size_t i = 0; i < segments.size(); i++) {
+		segment.add(segments[i]);
+		live.push_back(true);
+	}
+	publish(rebuild());
 }
 
 unsigned int gis_map::add_segment(unsigned int edgeid, double latitude1, double longitude1, double latitude2, double longitude2) {
-	int delta = segment.size();
-	segment.resize(delta + 1);
-	segment[delta].edgeid = edgeid;
-	segment[delta].latitude1 = latitude1;
-	segment[delta].longitude1 = longitude1;
-	segment[delta].latitude2 = latitude2;
-	segment[delta].longitude2 = longitude2;
-
-	container.add_segment(&segment, delta);
+	lock_guard<mutex> lock(writer);
+	unsigned int delta = segment.add(gis_segment(edgeid, latitude1, longitude1, latitude2, longitude2));
+	live.push_back(true);
+	gis_index * updated = index.load()->insert_segment(delta, epoch);
+	publish(updated != 0 ? updated : rebuild());
 	return delta;
 }
+
+bool gis_map::remove_segment(unsigned int segmentid) {
+	lock_guard<mutex> lock(writer);
+	if (segmentid >= live.size() || !live[segmentid]) {
+		return false;
+	}
+	live[segmentid] = false;
+	gis_index * current = index.load();
+	gis_index * updated = current->remove_segment(segmentid, epoch);
+	if (updated == 0) {
+		publish(rebuild());
+	}
+	else if (updated != current) {
+		publish(updated);
+	}
+	return true;
+}
+
+gis_map::snapshot::snapshot(const gis_map &map) : map(map) {
+	// The slot must be claimed before the index is loaded
+	slot = map.epoch.enter();
+	myindex = map.index.load();
+}
+
+gis_map::snapshot::~snapshot() {
+	map.epoch.exit(slot);
+}
+
+const gis_index * gis_map::snapshot::index(void) const {
+	return myindex;
+}
+
+const gis_segment & gis_map::snapshot::segment(unsigned int segmentid) const {
+	return map.segment[segmentid];
+}
+
+void gis_map::snapshot::nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const {
+	myindex->nearest(latitude, longitude, k, result);
+}
+
+void gis_map::snapshot::radius(double latitude, double longitude, double distance, vector<unsigned int> &result) const {
+	myindex->radius(latitude, longitude, distance, result);
+}
+
+void gis_map::snapshot::box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const {
+	myindex->box(latmin, lonmin, latmax, lonmax, result);
+}
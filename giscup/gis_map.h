@@ -1,18 +1,69 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include "gis_segment.h"
-#include "gis_container.h"
+#include "gis_segment_store.h"
+#include "gis_index.h"
+#include "gis_epoch.h"
 
 using namespace std;
 
+/**
+ * class gis_map
+ * Road network segments plus the spatial index over them.  The index backend
+ * is chosen at construction (see gis_index_type).
+ *
+ * Updates (add_segments, add_segment, remove_segment) are serialized by a
+ * writer mutex and publish a new index version atomically.  Readers never
+ * lock: they open a gis_map::snapshot, which pins the version that was
+ * current at that moment until the snapshot is destroyed.  Whatever a new
+ * version replaces is reclaimed through the map's gis_epoch once no snapshot
+ * can reach it.  The quadtree backend updates copy-on-write in O(depth);
+ * the others are rebuilt on every update.
+ */
 class gis_map {
 public:
-	gis_map();
+	gis_map(gis_index_type type = GIS_INDEX_QUADTREE);
 	~gis_map();
+	// Bulk load: rebuilds the index from scratch, use for the initial network
+	void add_segments(const vector<gis_segment> &segments);
+	// Live updates
 	unsigned int add_segment(unsigned int edgeid, double latitude1, double longitude1, double latitude2, double longitude2);
+	bool remove_segment(unsigned int segmentid);
+
+	/**
+	 * class gis_map::snapshot
+	 * Consistent, lock-free view of the map as of construction.  Holds one
+	 * of the map's GIS_EPOCH_MAX_READERS reader slots, so keep it short
+	 * lived (e.g. one per trajectory); opening one while all slots are
+	 * taken throws length_error.
+	 */
+	class snapshot {
+	public:
+		snapshot(const gis_map &map);
+		~snapshot();
+		const gis_index * index(void) const;
+		const gis_segment & segment(unsigned int segmentid) const;
+		void nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const;
+		void radius(double latitude, double longitude, double distance, vector<unsigned int> &result) const;
+		void box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const;
+	private:
+		snapshot(const snapshot &);
+		snapshot & operator=(const snapshot &);
+		const gis_map &map;
+		unsigned int slot;
+		const gis_index * myindex;
+	};
 private:
-	gis_container container;
-	vector<gis_segment> segment;
+	gis_index * rebuild(void);
+	void publish(gis_index * updated);
+	gis_index_type type;
+	gis_segment_store segment;
+	// Writer-side record of which segment ids are still indexed
+	vector<bool> live;
+	atomic<gis_index *> index;
+	mutable gis_epoch epoch;
+	mutex writer;
 };
-
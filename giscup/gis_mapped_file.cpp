@@ -0,0 +1,125 @@
+#include <stddef.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "gis_mapped_file.h"
+
+// Returned for empty files, which cannot be mapped
+static const char gis_mapped_file_empty[1] = { 0 };
+
+gis_mapped_file::gis_mapped_file(void) {
+	mydata = 0;
+	mysize = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = 0;
+#endif
+}
+
+gis_mapped_file::~gis_mapped_file(void) {
+	close();
+}
+
+#ifdef _WIN32
+
+bool gis_mapped_file::open(const char * filename) {
+	LARGE_INTEGER length;
+	close();
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	if (!GetFileSizeEx(file, &length)) {
+		close();
+		return false;
+	}
+	mysize = (size_t)length.QuadPart;
+	if (mysize == 0) {
+		mydata = gis_mapped_file_empty;
+		return true;
+	}
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping == 0) {
+		close();
+		return false;
+	}
+	mydata = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mydata == 0) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void gis_mapped_file::close(void) {
+	if (mydata != 0 && mydata != gis_mapped_file_empty) {
+		UnmapViewOfFile(mydata);
+	}
+	if (mapping != 0) {
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+	mydata = 0;
+	mysize = 0;
+	mapping = 0;
+	file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool gis_mapped_file::open(const char * filename) {
+	struct stat status;
+	void * address;
+	int file;
+	close();
+	file = ::open(filename, O_RDONLY);
+	if (file == -1) {
+		return false;
+	}
+	if (fstat(file, &status) != 0) {
+		::close(file);
+		return false;
+	}
+	mysize = (size_t)status.st_size;
+	if (mysize == 0) {
+		::close(file);
+		mydata = gis_mapped_file_empty;
+		return true;
+	}
+	address = mmap(0, mysize, PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping keeps the file referenced on its own
+	::close(file);
+	if (address == MAP_FAILED) {
+		mysize = 0;
+		return false;
+	}
+	madvise(address, mysize, MADV_SEQUENTIAL);
+	mydata = (const char *)address;
+	return true;
+}
+
+void gis_mapped_file::close(void) {
+	if (mydata != 0 && mydata != gis_mapped_file_empty) {
+		munmap((void *)mydata, mysize);
+	}
+	mydata = 0;
+	mysize = 0;
+}
+
+#endif
+
+const char * gis_mapped_file::data(void) const {
+	return mydata;
+}
+
+size_t gis_mapped_file::size(void) const {
+	return mysize;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * class gis_mapped_file
+ * Read-only memory mapping of a whole file.  The contents are not
+ * terminated; always stay within data() .. data() + size().
+ */
+class gis_mapped_file {
+public:
+	gis_mapped_file(void);
+	~gis_mapped_file(void);
+	bool open(const char * filename);
+	void close(void);
+	const char * data(void) const;
+	size_t size(void) const;
+private:
+	gis_mapped_file(const gis_mapped_file &);
+	gis_mapped_file & operator=(const gis_mapped_file &);
+	const char * mydata;
+	size_t mysize;
+#ifdef _WIN32
+	// HANDLEs, kept as void * so that <windows.h> stays out of this header
+	void * file;
+	void * mapping;
+#endif
+};
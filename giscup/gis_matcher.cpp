@@ -0,0 +1,20 @@
+#include <vector>
+#include "gis_matcher.h"
+
+using namespace std;
+
+void gis_match_nearest(const gis_map::snapshot &map, gis_trajectory &trajectory, vector<unsigned int> &candidates) {
+	trajectory.resize_results();
+	for (size_t i = 0; i < trajectory.size(); i++) {
+		candidates.clear();
+		map.nearest(trajectory.latitude[i], trajectory.longitude[i], 1, candidates);
+		if (candidates.empty()) {
+			trajectory.edgeid[i] = 0;
+			trajectory.confidence[i] = 0;
+		}
+		else {
+			trajectory.edgeid[i] = map.segment(candidates[0]).edgeid;
+			trajectory.confidence[i] = 1;
+		}
+	}
+}
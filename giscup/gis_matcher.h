@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+#include "gis_map.h"
+#include "gis_trajectory.h"
+
+using namespace std;
+
+/**
+ * Baseline matcher: assigns every sample to the edge of its nearest segment,
+ * with confidence 1.  Samples with no segment at all get edge 0 and
+ * confidence 0.  candidates is scratch space, reused between calls.
+ */
+void gis_match_nearest(const gis_map::snapshot &map, gis_trajectory &trajectory, vector<unsigned int> &candidates);
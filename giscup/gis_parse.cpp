@@ -0,0 +1,80 @@
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "gis_parse.h"
+
+using namespace std;
+
+int copy_until(const char * haystack, char needle, char * target, int start) {
+	int index = start, i = 0;
+	while (haystack[index] != needle && haystack[index] != 0) {
+		target[i] = haystack[index];
+		i++;
+		index++;
+	}
+	target[i] = 0;
+	if (index == start) {
+		return -1;
+	}
+	if (haystack[index] == needle) {
+		i++;
+	}
+	return i;
+}
+
+unsigned long parse_edge_geometry3(char * directory, vector<gis_segment> &segment) {
+	string filename;
+	unsigned int index, edgeid;
+	double lat1, lon1, lat2, lon2;
+	int begin, count;
+	bool first;
+	char *line, string1[25];
+	line = new char[1048576];
+
+	filename = gis_path_join(directory, "WA_EdgeGeometry.txt");
+	ifstream segmentfile(filename);
+	index = 0;
+
+	while (segmentfile.getline(line, 1048576)) {
+		// get the edge id
+		edgeid = atol(line);
+		int j = 0;
+		for (int i = 0; i < 4;) {
+			if (line[j] == '^') {
+				i++;
+				begin = j;
+			}
+			j++;
+		}
+		first = true;
+		while ((count = copy_until(line, '^', string1, begin + 1)) != -1) {
+			begin += count;
+			lat2 = atof(string1);
+			count = copy_until(line, '^', string1, begin + 1);
+			begin += count;
+			lon2 = atof(string1);
+			if (first) {
+				first = false;
+			}
+			else {
+				if (index >= segment.size()) {
+					segment.resize(index + 1);
+				}
+				segment[index].edgeid = edgeid;
+				segment[index].latitude1 = lat1;
+				segment[index].longitude1 = lon1;
+				segment[index].latitude2 = lat2;
+				segment[index].longitude2 = lon2;
+
+				index++;
+			}
+			lat1 = lat2;
+			lon1 = lon2;
+		}
+	}
+	delete [] line;
+	segmentfile.close();
+	return index;
+}
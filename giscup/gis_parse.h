@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "gis_segment.h"
+
+using namespace std;
+
+#ifdef _WIN32
+#define GIS_PATH_SEPARATOR '\\'
+#else
+#define GIS_PATH_SEPARATOR '/'
+#endif
+
+/**
+ * Join a directory and a relative path.  The relative path is written with
+ * '/' and converted to the platform's separator.
+ */
+inline string gis_path_join(const string &directory, const char * relative) {
+	string path = directory;
+	if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != GIS_PATH_SEPARATOR) {
+		path += GIS_PATH_SEPARATOR;
+	}
+	for (; *relative != 0; relative++) {
+		path += (*relative == '/') ? GIS_PATH_SEPARATOR : *relative;
+	}
+	return path;
+}
+
+/**
+ * Copy haystack[start..] into target up to (not including) the next needle
+ * or the end of the string.  Returns the number of characters consumed,
+ * counting the needle, or -1 if there was nothing to copy.
+ */
+int copy_until(const char * haystack, char needle, char * target, int start);
+
+/**
+ * Read <directory>/WA_EdgeGeometry.txt into one gis_segment per pair of
+ * consecutive shape points.  Returns the number of segments read.
+ */
+unsigned long parse_edge_geometry3(char * directory, vector<gis_segment> &segment);
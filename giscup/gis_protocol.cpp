@@ -0,0 +1,105 @@
+#include <string.h>
+#include "gis_protocol.h"
+
+inline void put_u32(char * p, unsigned int value) {
+	memcpy(p, &value, 4);
+}
+
+inline unsigned int get_u32(const char * p) {
+	unsigned int value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+inline void put_header(vector<char> &buffer, unsigned int magic, unsigned int requestid, size_t count, size_t samplesize) {
+	size_t offset = buffer.size();
+	buffer.resize(offset + GIS_PROTOCOL_HEADER_SIZE + count * samplesize);
+	put_u32(&buffer[offset], magic);
+	put_u32(&buffer[offset + 4], requestid);
+	put_u32(&buffer[offset + 8], (unsigned int)count);
+}
+
+/**
+ * Check the header at data and return the sample count, or -1 / 0 as for
+ * the decode functions.
+ */
+inline long get_header(const char * data, size_t size, unsigned int magic, size_t samplesize, unsigned int &requestid, unsigned int &count) {
+	if (size < GIS_PROTOCOL_HEADER_SIZE) {
+		return 0;
+	}
+	if (get_u32(data) != magic) {
+		return -1;
+	}
+	requestid = get_u32(data + 4);
+	count = get_u32(data + 8);
+	if (count > GIS_PROTOCOL_MAX_SAMPLES) {
+		return -1;
+	}
+	if (size < GIS_PROTOCOL_HEADER_SIZE + count * samplesize) {
+		return 0;
+	}
+	return (long)(GIS_PROTOCOL_HEADER_SIZE + count * samplesize);
+}
+
+void gis_encode_request(unsigned int requestid, const gis_trajectory &trajectory, size_t begin, size_t end, vector<char> &buffer) {
+	size_t offset = buffer.size() + GIS_PROTOCOL_HEADER_SIZE;
+	put_header(buffer, GIS_PROTOCOL_REQUEST_MAGIC, requestid, end - begin, GIS_PROTOCOL_REQUEST_SAMPLE_SIZE);
+	for (size_t i = begin; i < end; i++) {
+		char * p = &buffer[offset + (i - begin) * GIS_PROTOCOL_REQUEST_SAMPLE_SIZE];
+		put_u32(p, trajectory.time[i]);
+		memcpy(p + 4, &trajectory.latitude[i], 8);
+		memcpy(p + 12, &trajectory.longitude[i], 8);
+	}
+}
+
+void gis_encode_response(unsigned int requestid, const gis_trajectory &trajectory, vector<char> &buffer) {
+	size_t offset = buffer.size() + GIS_PROTOCOL_HEADER_SIZE;
+	put_header(buffer, GIS_PROTOCOL_RESPONSE_MAGIC, requestid, trajectory.size(), GIS_PROTOCOL_RESPONSE_SAMPLE_SIZE);
+	for (size_t i = 0; i < trajectory.size(); i++) {
+		char * p = &buffer[offset + i * GIS_PROTOCOL_RESPONSE_SAMPLE_SIZE];
+		float confidence = (float)trajectory.confidence[i];
+		put_u32(p, trajectory.time[i]);
+		put_u32(p + 4, trajectory.edgeid[i]);
+		memcpy(p + 8, &confidence, 4);
+	}
+}
+
+long gis_decode_request(const char * data, size_t size, unsigned int &requestid, gis_trajectory &trajectory) {
+	unsigned int count;
+	long length = get_header(data, size, GIS_PROTOCOL_REQUEST_MAGIC, GIS_PROTOCOL_REQUEST_SAMPLE_SIZE, requestid, count);
+	if (length <= 0) {
+		return length;
+	}
+	trajectory.clear();
+	trajectory.time.resize(count);
+	trajectory.latitude.resize(count);
+	trajectory.longitude.resize(count);
+	data += GIS_PROTOCOL_HEADER_SIZE;
+	for (unsigned int i = 0; i < count; i++, data += GIS_PROTOCOL_REQUEST_SAMPLE_SIZE) {
+		trajectory.time[i] = get_u32(data);
+		memcpy(&trajectory.latitude[i], data + 4, 8);
+		memcpy(&trajectory.longitude[i], data + 12, 8);
+	}
+	return length;
+}
+
+long gis_decode_response(const char * data, size_t size, unsigned int &requestid, gis_trajectory &trajectory) {
+	unsigned int count;
+	long length = get_header(data, size, GIS_PROTOCOL_RESPONSE_MAGIC, GIS_PROTOCOL_RESPONSE_SAMPLE_SIZE, requestid, count);
+	if (length <= 0) {
+		return length;
+	}
+	trajectory.clear();
+	trajectory.time.resize(count);
+	trajectory.edgeid.resize(count);
+	trajectory.confidence.resize(count);
+	data += GIS_PROTOCOL_HEADER_SIZE;
+	for (unsigned int i = 0; i < count; i++, data += GIS_PROTOCOL_RESPONSE_SAMPLE_SIZE) {
+		float confidence;
+		trajectory.time[i] = get_u32(data);
+		trajectory.edgeid[i] = get_u32(data + 4);
+		memcpy(&confidence, data + 8, 4);
+		trajectory.confidence[i] = confidence;
+	}
+	return length;
+}
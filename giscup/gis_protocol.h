@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include "gis_trajectory.h"
+
+using namespace std;
+
+/**
+ * Binary framing spoken by gis_server over its Unix domain socket.  Both
+ * ends are on the same machine, so all fields are in host byte order.
+ *
+ * Every frame starts with a 12 byte header:
+ *   uint32 magic, uint32 requestid, uint32 count
+ * A request is followed by count samples of 20 bytes:
+ *   uint32 time, float64 latitude, float64 longitude
+ * A response carries the same requestid and is followed by count results
+ * of 12 bytes, in the order of the request's samples:
+ *   uint32 time, uint32 edgeid, float32 confidence
+ * Responses may come back in a different order than the requests were sent.
+ */
+
+// "GMMQ" and "GMMR" as bytes on little-endian machines
+#define GIS_PROTOCOL_REQUEST_MAGIC 0x514d4d47
+#define GIS_PROTOCOL_RESPONSE_MAGIC 0x524d4d47
+#define GIS_PROTOCOL_HEADER_SIZE 12
+#define GIS_PROTOCOL_REQUEST_SAMPLE_SIZE 20
+#define GIS_PROTOCOL_RESPONSE_SAMPLE_SIZE 12
+// Larger frames are rejected as malformed
+#define GIS_PROTOCOL_MAX_SAMPLES (1 << 20)
+
+// Append a request frame for samples [begin, end) of trajectory
+void gis_encode_request(unsigned int requestid, const gis_trajectory &trajectory, size_t begin, size_t end, vector<char> &buffer);
+// Append a response frame for every sample of a matched trajectory
+void gis_encode_response(unsigned int requestid, const gis_trajectory &trajectory, vector<char> &buffer);
+
+/**
+ * Decode the frame at the start of data.  Returns the number of bytes it
+ * took, 0 if data does not hold a whole frame yet, or -1 if the frame is
+ * malformed.  trajectory is cleared and refilled: a request fills time,
+ * latitude and longitude; a response fills time, edgeid and confidence.
+ */
+long gis_decode_request(const char * data, size_t size, unsigned int &requestid, gis_trajectory &trajectory);
+long gis_decode_response(const char * data, size_t size, unsigned int &requestid, gis_trajectory &trajectory);
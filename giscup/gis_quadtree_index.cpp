@@ -0,0 +1,73 @@
+#include <vector>
+#include <algorithm>
+#include "gis_quadtree_index.h"
+
+using namespace std;
+
+gis_quadtree_index::gis_quadtree_index(const gis_segment_store * segment) : gis_index(segment) {
+	root = new gis_container();
+	root->setdata(1 << 31, 1 << 31, 32, 90, 180, -90, -180);
+}
+
+gis_quadtree_index::gis_quadtree_index(const gis_segment_store * segment, gis_container * root) : gis_index(segment) {
+	gis_quadtree_index::root = root;
+}
+
+gis_quadtree_index::~gis_quadtree_index(void) {
+	if (root != 0) {
+		delete root;
+	}
+}
+
+void gis_quadtree_index::release(void * index) {
+	gis_quadtree_index * i = (gis_quadtree_index *)index;
+	i->root = 0;
+	delete i;
+}
+
+const char * gis_quadtree_index::name(void) const {
+	return "quadtree";
+}
+
+void gis_quadtree_index::build(const vector<unsigned int> &segmentids) {
+	for (size_t i = 0; i < segmentids.size(); i++) {
+		root->add_segment(segment, segmentids[i]);
+	}
+}
+
+void gis_quadtree_index::nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const {
+	root->find_nearest(segment, latitude, longitude, k, result);
+}
+
+void gis_quadtree_index::box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const {
+	size_t begin = result.size(), kept = begin;
+	root->find_segments_in_box(latmin, lonmin, latmax, lonmax, result);
+	// Leaves overlap the box, their segments need not
+	sort(result.begin() + begin, result.end());
+	result.erase(unique(result.begin() + begin, result.end()), result.end());
+	for (size_t i = begin; i < result.size(); i++) {
+		if ((*segment)[result[i]].intersects_box(latmin, lonmin, latmax, lonmax)) {
+			result[kept++] = result[i];
+		}
+	}
+	result.resize(kept);
+}
+
+size_t gis_quadtree_index::memory_usage(void) const {
+	return sizeof(gis_quadtree_index) + root->memory_usage();
+}
+
+gis_index * gis_quadtree_index::insert_segment(unsigned int segmentid, gis_epoch &epoch) {
+	gis_quadtree_index * copy = new gis_quadtree_index(segment, root->insert_segment(segment, segmentid, epoch));
+	epoch.retire(this, release);
+	return copy;
+}
+
+gis_index * gis_quadtree_index::remove_segment(unsigned int segmentid, gis_epoch &epoch) {
+	gis_container * updated = root->remove_segment(segment, segmentid, epoch);
+	if (updated == root) {
+		return this;
+	}
+	epoch.retire(this, release);
+	return new gis_quadtree_index(segment, updated);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "gis_index.h"
+#include "gis_container.h"
+
+using namespace std;
+
+/**
+ * class gis_quadtree_index
+ * gis_index backed by the gis_container PR-quadtree, rooted at the whole
+ * globe.  The only backend with incremental updates: insert_segment() and
+ * remove_segment() path-copy the tree and share the rest with the old version.
+ */
+class gis_quadtree_index : public gis_index {
+public:
+	gis_quadtree_index(const gis_segment_store * segment);
+	~gis_quadtree_index(void);
+	// Delete the index object but not the (shared) tree below it
+	static void release(void * index);
+	const char * name(void) const;
+	void build(const vector<unsigned int> &segmentids);
+	void nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const;
+	void box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const;
+	size_t memory_usage(void) const;
+	gis_index * insert_segment(unsigned int segmentid, gis_epoch &epoch);
+	gis_index * remove_segment(unsigned int segmentid, gis_epoch &epoch);
+private:
+	gis_quadtree_index(const gis_segment_store * segment, gis_container * root);
+	gis_container * root;
+};
@@ -0,0 +1,122 @@
+#include <math.h>
+#include <string.h>
+#include "gis_result_writer.h"
+
+// Longest line: two 10 digit integers and a formatted double
+#define GIS_RESULT_WRITER_LINE 64
+
+gis_result_writer::gis_result_writer(void) {
+	block = new char[GIS_RESULT_WRITER_BLOCK];
+	used = 0;
+}
+
+gis_result_writer::~gis_result_writer(void) {
+	close();
+	delete [] block;
+}
+
+bool gis_result_writer::open(const char * filename) {
+	close();
+	file.clear();
+	file.open(filename, ios::out | ios::binary | ios::trunc);
+	return file.is_open();
+}
+
+bool gis_result_writer::close(void) {
+	if (!file.is_open()) {
+		return true;
+	}
+	flush();
+	file.close();
+	return !file.fail();
+}
+
+void gis_result_writer::flush(void) {
+	if (used > 0) {
+		file.write(block, used);
+		used = 0;
+	}
+}
+
+void gis_result_writer::write(unsigned int time, unsigned int edgeid, double confidence) {
+	char * p;
+	if (used + GIS_RESULT_WRITER_LINE > GIS_RESULT_WRITER_BLOCK) {
+		flush();
+	}
+	p = block + used;
+	p += format_unsigned(p, time);
+	*p++ = ',';
+	p += format_unsigned(p, edgeid);
+	*p++ = ',';
+	p += format_fixed(p, confidence, GIS_RESULT_WRITER_DECIMALS);
+	*p++ = '\n';
+	used = p - block;
+}
+
+void gis_result_writer::write(const gis_trajectory &trajectory) {
+	for (size_t i = 0; i < trajectory.size(); i++) {
+		write(trajectory.time[i], trajectory.edgeid[i], trajectory.confidence[i]);
+	}
+}
+
+/**
+ * Digits are produced two at a time from a table, least significant first,
+ * into a scratch buffer and then copied out in order.
+ */
+size_t gis_result_writer::format_unsigned(char * buffer, unsigned int value) {
+	static const char pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	char scratch[10];
+	char * p = scratch + sizeof(scratch);
+	size_t length;
+	while (value >= 100) {
+		unsigned int pair = (value % 100) * 2;
+		value /= 100;
+		*--p = pairs[pair + 1];
+		*--p = pairs[pair];
+	}
+	if (value >= 10) {
+		*--p = pairs[value * 2 + 1];
+		*--p = pairs[value * 2];
+	}
+	else {
+		*--p = (char)('0' + value);
+	}
+	length = scratch + sizeof(scratch) - p;
+	memcpy(buffer, p, length);
+	return length;
+}
+
+/**
+ * Fixed-point formatting for values that fit in 32 bits once scaled, such as
+ * confidences.  The value is rounded to the requested number of decimals
+ * first so that carries (0.999 -> 1.00) come out right.
+ */
+size_t gis_result_writer::format_fixed(char * buffer, double value, int decimals) {
+	static const unsigned long long power10[] = {
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+	};
+	unsigned long long scaled, fraction;
+	size_t length = 0;
+	if (decimals > 9) {
+		decimals = 9;
+	}
+	if (value < 0) {
+		buffer[length++] = '-';
+		value = -value;
+	}
+	scaled = (unsigned long long)floor(value * power10[decimals] + 0.5);
+	length += format_unsigned(buffer + length, (unsigned int)(scaled / power10[decimals]));
+	if (decimals > 0) {
+		fraction = scaled % power10[decimals];
+		buffer[length++] = '.';
+		for (int i = decimals - 1; i >= 0; i--) {
+			buffer[length + i] = (char)('0' + fraction % 10);
+			fraction /= 10;
+		}
+		length += decimals;
+	}
+	return length;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <fstream>
+#include "gis_trajectory.h"
+
+using namespace std;
+
+// Bytes formatted before a block is written out
+#define GIS_RESULT_WRITER_BLOCK (1 << 20)
+// Digits after the decimal point of the confidence
+#define GIS_RESULT_WRITER_DECIMALS 2
+
+/**
+ * class gis_result_writer
+ * Writes contest output files, one "time,edgeid,confidence" line per sample.
+ * Lines are formatted by hand into a large block that is written to the
+ * file in one call whenever it fills up.
+ */
+class gis_result_writer {
+public:
+	gis_result_writer(void);
+	~gis_result_writer(void);
+	bool open(const char * filename);
+	// Flush and close, returns false if any write failed
+	bool close(void);
+	void write(unsigned int time, unsigned int edgeid, double confidence);
+	// Write every sample of a matched trajectory
+	void write(const gis_trajectory &trajectory);
+	// Format into buffer, returning the number of characters written
+	static size_t format_unsigned(char * buffer, unsigned int value);
+	static size_t format_fixed(char * buffer, double value, int decimals);
+private:
+	gis_result_writer(const gis_result_writer &);
+	gis_result_writer & operator=(const gis_result_writer &);
+	void flush(void);
+	ofstream file;
+	char * block;
+	size_t used;
+};
@@ -0,0 +1,174 @@
+#include <math.h>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include "gis_rtree_index.h"
+
+using namespace std;
+
+gis_rtree_index::gis_rtree_index(const gis_segment_store * segment) : gis_index(segment) {
+}
+
+gis_rtree_index::~gis_rtree_index(void) {
+}
+
+const char * gis_rtree_index::name(void) const {
+	return "rtree";
+}
+
+/**
+ * Sort-Tile-Recursive ordering: sort by longitude, cut into vertical slabs
+ * of S * M entries (S = ceil(sqrt(P)), P = number of nodes of M entries),
+ * then sort each slab by latitude.  Consecutive runs of M entries then form
+ * nodes that are tiled over the data.
+ */
+void gis_rtree_index::str_sort(vector<entry> &entries) {
+	struct by_longitude {
+		bool operator()(const entry &a, const entry &b) const {
+			return a.lonmin + a.lonmax < b.lonmin + b.lonmax;
+		}
+	};
+	struct by_latitude {
+		bool operator()(const entry &a, const entry &b) const {
+			return a.latmin + a.latmax < b.latmin + b.latmax;
+		}
+	};
+	size_t nodes, slabs, slabsize;
+	nodes = (entries.size() + GIS_RTREE_NODE_CAPACITY - 1) / GIS_RTREE_NODE_CAPACITY;
+	slabs = (size_t)ceil(sqrt((double)nodes));
+	slabsize = slabs * GIS_RTREE_NODE_CAPACITY;
+	sort(entries.begin(), entries.end(), by_longitude());
+	for (size_t i = 0; i < entries.size(); i += slabsize) {
+		sort(entries.begin() + i, entries.begin() + min(i + slabsize, entries.size()), by_latitude());
+	}
+}
+
+void gis_rtree_index::build(const vector<unsigned int> &segmentids) {
+	levels.clear();
+	if (segmentids.empty()) {
+		return;
+	}
+	levels.push_back(vector<entry>(segmentids.size()));
+	for (size_t i = 0; i < segmentids.size(); i++) {
+		const gis_segment &s = (*segment)[segmentids[i]];
+		entry &e = levels[0][i];
+		e.latmin = min(s.latitude1, s.latitude2);
+		e.latmax = max(s.latitude1, s.latitude2);
+		e.lonmin = min(s.longitude1, s.longitude2);
+		e.lonmax = max(s.longitude1, s.longitude2);
+		e.first = segmentids[i];
+		e.count = 0;
+	}
+	// Pack each level into nodes until the root fits in a single node
+	while (levels.back().size() > GIS_RTREE_NODE_CAPACITY) {
+		vector<entry> &children = levels.back();
+		vector<entry> parents;
+		str_sort(children);
+		for (size_t i = 0; i < children.size(); i += GIS_RTREE_NODE_CAPACITY) {
+			entry e = children[i];
+			e.first = (unsigned int)i;
+			e.count = (unsigned int)min((size_t)GIS_RTREE_NODE_CAPACITY, children.size() - i);
+			for (size_t j = i + 1; j < i + e.count; j++) {
+				e.latmin = min(e.latmin, children[j].latmin);
+				e.latmax = max(e.latmax, children[j].latmax);
+				e.lonmin = min(e.lonmin, children[j].lonmin);
+				e.lonmax = max(e.lonmax, children[j].lonmax);
+			}
+			parents.push_back(e);
+		}
+		levels.push_back(parents);
+	}
+}
+
+/**
+ * Best-first k-nearest search over node boxes; segment entries are keyed by
+ * their exact distance, so they come off the queue in order.
+ */
+void gis_rtree_index::nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const {
+	struct candidate {
+		double distance;
+		size_t level;
+		size_t index;
+		bool operator>(const candidate &other) const {
+			return distance > other.distance;
+		}
+	};
+	priority_queue<candidate, vector<candidate>, greater<candidate> > queue;
+	size_t begin = result.size();
+	if (levels.empty()) {
+		return;
+	}
+	// Start from the children of the root
+	entry root;
+	root.first = 0;
+	root.count = (unsigned int)levels.back().size();
+	const entry * e = &root;
+	size_t level = levels.size();
+	for (;;) {
+		for (size_t i = e->first; i < e->first + e->count; i++) {
+			const entry &child = levels[level - 1][i];
+			candidate next;
+			next.level = level - 1;
+			next.index = i;
+			if (next.level == 0) {
+				next.distance = (*segment)[child.first].distance(latitude, longitude);
+			}
+			else {
+				next.distance = gis_box_distance(latitude, longitude, child.latmin, child.lonmin, child.latmax, child.lonmax);
+			}
+			queue.push(next);
+		}
+		// Report segments until a node comes off the queue, then expand it
+		for (;;) {
+			if (queue.empty() || result.size() - begin >= k) {
+				return;
+			}
+			candidate c = queue.top();
+			queue.pop();
+			e = &levels[c.level][c.index];
+			if (c.level > 0) {
+				level = c.level;
+				break;
+			}
+			result.push_back(e->first);
+		}
+	}
+}
+
+void gis_rtree_index::box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const {
+	vector<pair<size_t, size_t> > stack;
+	if (levels.empty()) {
+		return;
+	}
+	for (size_t i = 0; i < levels.back().size(); i++) {
+		stack.push_back(make_pair(levels.size() - 1, i));
+	}
+	while (!stack.empty()) {
+		size_t level = stack.back().first;
+		const entry &e = levels[level][stack.back().second];
+		stack.pop_back();
+		if (e.latmax < latmin || e.latmin > latmax || e.lonmax < lonmin || e.lonmin > lonmax) {
+			continue;
+		}
+		if (level == 0) {
+			// The bounding box overlaps, check the segment itself
+			if ((*segment)[e.first].intersects_box(latmin, lonmin, latmax, lonmax)) {
+				result.push_back(e.first);
+			}
+		}
+		else {
+			for (size_t i = e.first; i < e.first + e.count; i++) {
+				stack.push_back(make_pair(level - 1, i));
+			}
+		}
+	}
+}
+
+size_t gis_rtree_index::memory_usage(void) const {
+	size_t bytes = sizeof(gis_rtree_index);
+	for (size_t i = 0; i < levels.size(); i++) {
+		bytes += sizeof(vector<entry>) + levels[i].capacity() * sizeof(entry);
+	}
+	return bytes;
+}
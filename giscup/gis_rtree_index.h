@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include "gis_index.h"
+
+using namespace std;
+
+#define GIS_RTREE_NODE_CAPACITY 16
+
+/**
+ * class gis_rtree_index
+ * gis_index backed by a static R-tree over segment bounding boxes, bulk
+ * loaded with Sort-Tile-Recursive packing so that every node is full.
+ *
+ * The tree is stored level by level.  levels[0] holds one entry per segment
+ * (first = segment id); an entry of levels[i] covers the entries
+ * levels[i - 1][first .. first + count - 1].  The last level holds the
+ * children of the (implicit) root.
+ */
+class gis_rtree_index : public gis_index {
+public:
+	gis_rtree_index(const gis_segment_store * segment);
+	~gis_rtree_index(void);
+	const char * name(void) const;
+	void build(const vector<unsigned int> &segmentids);
+	void nearest(double latitude, double longitude, unsigned int k, vector<unsigned int> &result) const;
+	void box(double latmin, double lonmin, double latmax, double lonmax, vector<unsigned int> &result) const;
+	size_t memory_usage(void) const;
+private:
+	struct entry {
+		double latmin;
+		double lonmin;
+		double latmax;
+		double lonmax;
+		unsigned int first;
+		unsigned int count;
+	};
+	static void str_sort(vector<entry> &entries);
+	vector<vector<entry> > levels;
+};
@@ -1,3 +1,4 @@
+#include <math.h>
 #include "gis_segment.h"
 
 
@@ -11,3 +12,72 @@ gis_segment::gis_segment(unsigned int edge, double lat1, double lon1, double lat
 
 gis_segment::~gis_segment(void) {
 }
+
+/**
+ * Latitude and longitude are treated as plain y and x, which is accurate
+ * enough for ranking nearby segments against each other.
+ */
+double gis_segment::distance(double lat, double lon) const {
+	double dlat, dlon, t;
+	dlat = latitude2 - latitude1;
+	dlon = longitude2 - longitude1;
+	t = 0;
+	if (dlat != 0 || dlon != 0) {
+		// Project the point onto the segment and clamp to its ends
+		t = ((lat - latitude1) * dlat + (lon - longitude1) * dlon) / (dlat * dlat + dlon * dlon);
+		if (t < 0) {
+			t = 0;
+		}
+		else if (t > 1) {
+			t = 1;
+		}
+	}
+	dlat = lat - (latitude1 + t * dlat);
+	dlon = lon - (longitude1 + t * dlon);
+	return sqrt(dlat * dlat + dlon * dlon);
+}
+
+/**
+ * Liang-Barsky clipping: the segment is latitude1 + t * dlat, longitude1 +
+ * t * dlon for t in [0, 1]; each side of the box narrows that range, and the
+ * segment touches the box if anything is left.
+ */
+bool gis_segment::intersects_box(double latmin, double lonmin, double latmax, double lonmax) const {
+	double p[4], q[4], t0 = 0, t1 = 1;
+	p[0] = -(latitude2 - latitude1);
+	q[0] = latitude1 - latmin;
+	p[1] = latitude2 - latitude1;
+	q[1] = latmax - latitude1;
+	p[2] = -(longitude2 - longitude1);
+	q[2] = longitude1 - lonmin;
+	p[3] = longitude2 - longitude1;
+	q[3] = lonmax - longitude1;
+	for (int i = 0; i < 4; i++) {
+		if (p[i] == 0) {
+			// Parallel to this side, so it is either wholly inside or outside it
+			if (q[i] < 0) {
+				return false;
+			}
+		}
+		else {
+			double t = q[i] / p[i];
+			if (p[i] < 0) {
+				if (t > t1) {
+					return false;
+				}
+				if (t > t0) {
+					t0 = t;
+				}
+			}
+			else {
+				if (t < t0) {
+					return false;
+				}
+				if (t < t1) {
+					t1 = t;
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -5,6 +5,10 @@ public:
 	gis_segment(unsigned int edge, double lat1, double lon1, double lat2, double lon2);
 	gis_segment(){};
 	~gis_segment(void);
+	// Planar distance, in degrees, from (lat, lon) to the closest point of the segment
+	double distance(double lat, double lon) const;
+	// True if any part of the segment lies within the given box
+	bool intersects_box(double latmin, double lonmin, double latmax, double lonmax) const;
 	unsigned int edgeid;
 	double latitude1;
 	double longitude1;
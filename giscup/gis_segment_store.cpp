@@ -0,0 +1,35 @@
+#include <stdexcept>
+#include "gis_segment_store.h"
+
+gis_segment_store::gis_segment_store(void) {
+	count = 0;
+	for (int i = 0; i < GIS_SEGMENT_STORE_MAX_BLOCKS; i++) {
+		block[i] = 0;
+	}
+}
+
+gis_segment_store::~gis_segment_store(void) {
+	for (int i = 0; i < GIS_SEGMENT_STORE_MAX_BLOCKS; i++) {
+		if (block[i] != 0) {
+			delete [] block[i];
+		}
+	}
+}
+
+unsigned int gis_segment_store::add(const gis_segment &segment) {
+	unsigned int blockindex = count >> GIS_SEGMENT_STORE_BLOCK_BITS;
+	if (blockindex >= GIS_SEGMENT_STORE_MAX_BLOCKS) {
+		throw length_error("gis_segment_store is full");
+	}
+	if (block[blockindex] == 0) {
+		// The directory slot is written before any id inside the block is
+		// handed out, so it is visible to every reader that can see the id.
+		block[blockindex] = new gis_segment[GIS_SEGMENT_STORE_BLOCK_SIZE];
+	}
+	block[blockindex][count & (GIS_SEGMENT_STORE_BLOCK_SIZE - 1)] = segment;
+	return count++;
+}
+
+unsigned int gis_segment_store::size(void) const {
+	return count;
+}
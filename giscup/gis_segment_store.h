@@ -0,0 +1,38 @@
+#pragma once
+
+#include "gis_segment.h"
+
+using namespace std;
+
+#define GIS_SEGMENT_STORE_BLOCK_BITS 12
+#define GIS_SEGMENT_STORE_BLOCK_SIZE (1 << GIS_SEGMENT_STORE_BLOCK_BITS)
+#define GIS_SEGMENT_STORE_MAX_BLOCKS 4096
+
+/**
+ * class gis_segment_store
+ * Append-only table of segments, indexed by segment id.  Segments are kept in
+ * fixed-size blocks hanging off a preallocated block directory, so an entry
+ * never moves once written.  This allows readers of a published map version
+ * to look up any segment id reachable from that version while the writer
+ * keeps appending (a vector would reallocate underneath them).
+ *
+ * Only a single writer may call add() at a time.  Removed segments are not
+ * reclaimed; their ids simply stop being referenced by the index.
+ */
+class gis_segment_store {
+public:
+	gis_segment_store(void);
+	~gis_segment_store(void);
+	// Append a segment and return its id
+	unsigned int add(const gis_segment &segment);
+	// Number of segments appended so far (writer side)
+	unsigned int size(void) const;
+	const gis_segment & operator[](unsigned int segmentid) const {
+		return block[segmentid >> GIS_SEGMENT_STORE_BLOCK_BITS][segmentid & (GIS_SEGMENT_STORE_BLOCK_SIZE - 1)];
+	}
+private:
+	gis_segment_store(const gis_segment_store &);
+	gis_segment_store & operator=(const gis_segment_store &);
+	gis_segment * block[GIS_SEGMENT_STORE_MAX_BLOCKS];
+	unsigned int count;
+};
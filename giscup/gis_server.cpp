@@ -0,0 +1,403 @@
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+
+#include "gis_server.h"
+#include "gis_protocol.h"
+#include "gis_matcher.h"
+
+using namespace std;
+
+// Report a vanished client as an error rather than raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define GIS_SERVER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define GIS_SERVER_SEND_FLAGS 0
+#endif
+
+inline bool set_nonblocking(int fd) {
+	int flags = fcntl(fd, F_GETFL, 0);
+	return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+gis_server::gis_server(const gis_map &map) : map(map) {
+	listener = -1;
+	wakepipe[0] = wakepipe[1] = -1;
+	stopping.store(false);
+	matchedrequests.store(0);
+	matchedsamples.store(0);
+	nextconnection = 0;
+	queuedsamples = 0;
+	idlematchers = 0;
+}
+
+gis_server::~gis_server(void) {
+	for (std::map<unsigned long, connection>::iterator i = connections.begin(); i != connections.end(); ++i) {
+		close(i->second.fd);
+	}
+	if (listener != -1) {
+		close(listener);
+		unlink(path.c_str());
+	}
+	if (wakepipe[0] != -1) {
+		close(wakepipe[0]);
+		close(wakepipe[1]);
+	}
+	for (size_t i = 0; i < jobs.size(); i++) {
+		delete jobs[i];
+	}
+	for (size_t i = 0; i < freejobs.size(); i++) {
+		delete freejobs[i];
+	}
+}
+
+bool gis_server::listen(const char * path) {
+	struct sockaddr_un address;
+	struct stat status;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		return false;
+	}
+	if (lstat(path, &status) == 0) {
+		// Only a socket left behind by an earlier run may be replaced,
+		// never a file that happens to be in the way
+		if (!S_ISSOCK(status.st_mode) || unlink(path) != 0) {
+			return false;
+		}
+	}
+	else if (errno != ENOENT) {
+		return false;
+	}
+	if (pipe(wakepipe) != 0 || !set_nonblocking(wakepipe[0]) || !set_nonblocking(wakepipe[1])) {
+		return false;
+	}
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == -1) {
+		return false;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || ::listen(listener, SOMAXCONN) != 0 || !set_nonblocking(listener)) {
+		close(listener);
+		listener = -1;
+		return false;
+	}
+	gis_server::path = path;
+	return true;
+}
+
+void gis_server::stop(void) {
+	stopping.store(true);
+	wake();
+}
+
+void gis_server::wake(void) {
+	char byte = 0;
+	// A full pipe already guarantees a wakeup, so the result does not matter
+	ssize_t ignored = write(wakepipe[1], &byte, 1);
+	(void)ignored;
+}
+
+unsigned long gis_server::requests(void) const {
+	return matchedrequests.load();
+}
+
+unsigned long gis_server::samples(void) const {
+	return matchedsamples.load();
+}
+
+/**
+ * Matcher thread.  Takes a batch of queued jobs (waiting for more to join
+ * only when the server is busy), matches it against one snapshot, and
+ * queues the responses for the I/O thread.
+ */
+void gis_server::matcher(void) {
+	vector<job *> batch;
+	vector<unsigned int> candidates;
+	unique_lock<mutex> lock(jobmutex);
+	for (;;) {
+		size_t batchsamples = 0;
+		while (!stopping.load() && jobs.empty()) {
+			idlematchers++;
+			jobready.wait(lock);
+			idlematchers--;
+		}
+		if (stopping.load()) {
+			return;
+		}
+		// A backlog with every other matcher busy means requests are arriving
+		// concurrently, so give more of them a chance to join the batch.
+		// Otherwise waiting would only add latency.
+		chrono::steady_clock::time_point deadline = jobs.front()->arrival + chrono::microseconds(GIS_SERVER_BATCH_DELAY_US);
+		while (!stopping.load() && jobs.size() > 1 && idlematchers == 0 && queuedsamples < GIS_SERVER_BATCH_SAMPLES && chrono::steady_clock::now() < deadline) {
+			jobready.wait_until(lock, deadline);
+		}
+		if (jobs.empty()) {
+			// Another matcher took them
+			continue;
+		}
+		batch.clear();
+		while (!jobs.empty() && (batch.empty() || batchsamples + jobs.front()->trajectory.size() <= GIS_SERVER_BATCH_SAMPLES)) {
+			batch.push_back(jobs.front());
+			batchsamples += jobs.front()->trajectory.size();
+			queuedsamples -= jobs.front()->trajectory.size();
+			jobs.pop_front();
+		}
+		lock.unlock();
+
+		vector<response> encoded(batch.size());
+		{
+			gis_map::snapshot snapshot(map);
+			for (size_t i = 0; i < batch.size(); i++) {
+				gis_match_nearest(snapshot, batch[i]->trajectory, candidates);
+				encoded[i].connection = batch[i]->connection;
+				encoded[i].samples = batch[i]->trajectory.size();
+				gis_encode_response(batch[i]->requestid, batch[i]->trajectory, encoded[i].frame);
+			}
+		}
+		matchedrequests.fetch_add(batch.size());
+		matchedsamples.fetch_add(batchsamples);
+		{
+			lock_guard<mutex> responselock(responsemutex);
+			for (size_t i = 0; i < encoded.size(); i++) {
+				responses.push_back(response());
+				responses.back().connection = encoded[i].connection;
+				responses.back().samples = encoded[i].samples;
+				responses.back().frame.swap(encoded[i].frame);
+			}
+		}
+		wake();
+
+		lock.lock();
+		freejobs.insert(freejobs.end(), batch.begin(), batch.end());
+	}
+}
+
+void gis_server::accept_connections(void) {
+	for (;;) {
+		int fd = accept(listener, 0, 0);
+		if (fd == -1) {
+			return;
+		}
+		if (!set_nonblocking(fd)) {
+			close(fd);
+			continue;
+		}
+		connection &c = connections[nextconnection++];
+		c.fd = fd;
+		c.sent = 0;
+		c.pendingrequests = 0;
+		c.pendingsamples = 0;
+		c.readclosed = false;
+	}
+}
+
+/**
+ * Read one chunk of whatever the client has sent.  Returns false when the
+ * connection should be closed; end of input only marks it read-closed.
+ */
+bool gis_server::read_connection(connection &c) {
+	for (;;) {
+		size_t size = c.input.size();
+		c.input.resize(size + GIS_SERVER_READ_CHUNK);
+		ssize_t count = read(c.fd, &c.input[size], GIS_SERVER_READ_CHUNK);
+		c.input.resize(size + (count > 0 ? count : 0));
+		if (count > 0) {
+			return true;
+		}
+		if (count == 0) {
+			c.readclosed = true;
+			return true;
+		}
+		if (errno != EINTR) {
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+	}
+}
+
+/**
+ * Queue the complete requests buffered on a connection, stopping once it is
+ * backlogged; the rest stay buffered until its responses have gone out.
+ * Returns false when the connection should be closed.
+ */
+bool gis_server::queue_requests(unsigned long id, connection &c) {
+	size_t consumed = 0;
+	long length = 0;
+	job * j = 0;
+	while (consumed < c.input.size() && !backlogged(c)) {
+		unsigned int requestid;
+		if (j == 0) {
+			lock_guard<mutex> lock(jobmutex);
+			if (freejobs.empty()) {
+				j = new job();
+			}
+			else {
+				j = freejobs.back();
+				freejobs.pop_back();
+			}
+		}
+		length = gis_decode_request(&c.input[consumed], c.input.size() - consumed, requestid, j->trajectory);
+		if (length <= 0) {
+			break;
+		}
+		consumed += length;
+		c.pendingrequests++;
+		c.pendingsamples += j->trajectory.size();
+		j->connection = id;
+		j->requestid = requestid;
+		j->arrival = chrono::steady_clock::now();
+		lock_guard<mutex> lock(jobmutex);
+		jobs.push_back(j);
+		queuedsamples += j->trajectory.size();
+		if (queuedsamples >= GIS_SERVER_BATCH_SAMPLES) {
+			jobready.notify_all();
+		}
+		else {
+			jobready.notify_one();
+		}
+		j = 0;
+	}
+	if (j != 0) {
+		lock_guard<mutex> lock(jobmutex);
+		freejobs.push_back(j);
+	}
+	if (length < 0) {
+		// Malformed frame, the stream cannot be resynchronized
+		return false;
+	}
+	c.input.erase(c.input.begin(), c.input.begin() + consumed);
+	return true;
+}
+
+bool gis_server::backlogged(const connection &c) {
+	return c.pendingrequests >= GIS_SERVER_MAX_PENDING_REQUESTS
+		|| c.pendingsamples >= GIS_SERVER_MAX_PENDING_SAMPLES
+		|| c.output.size() - c.sent >= GIS_SERVER_MAX_PENDING_OUTPUT;
+}
+
+/**
+ * Send as much pending output as the socket takes.  Returns false when the
+ * connection should be closed.
+ */
+bool gis_server::write_connection(connection &c) {
+	while (c.sent < c.output.size()) {
+		ssize_t count = send(c.fd, &c.output[c.sent], c.output.size() - c.sent, GIS_SERVER_SEND_FLAGS);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		c.sent += count;
+	}
+	c.output.clear();
+	c.sent = 0;
+	return true;
+}
+
+/**
+ * Move finished responses onto their connections' output.  Responses for
+ * connections that have gone away are dropped.
+ */
+void gis_server::collect_responses(void) {
+	vector<response> ready;
+	char drain[256];
+	while (read(wakepipe[0], drain, sizeof(drain)) > 0) {
+	}
+	{
+		lock_guard<mutex> lock(responsemutex);
+		ready.swap(responses);
+	}
+	for (size_t i = 0; i < ready.size(); i++) {
+		std::map<unsigned long, connection>::iterator c = connections.find(ready[i].connection);
+		if (c != connections.end()) {
+			c->second.output.insert(c->second.output.end(), ready[i].frame.begin(), ready[i].frame.end());
+			c->second.pendingrequests--;
+			c->second.pendingsamples -= ready[i].samples;
+		}
+	}
+}
+
+void gis_server::run(unsigned int threads) {
+	vector<thread> matchers;
+	vector<pollfd> fds;
+	vector<unsigned long> ids;
+
+	if (threads == 0) {
+		threads = 1;
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		matchers.push_back(thread(&gis_server::matcher, this));
+	}
+	while (!stopping.load()) {
+		pollfd p;
+		fds.clear();
+		ids.clear();
+		p.fd = wakepipe[0];
+		p.events = POLLIN;
+		fds.push_back(p);
+		p.fd = listener;
+		fds.push_back(p);
+		for (std::map<unsigned long, connection>::iterator i = connections.begin(); i != connections.end(); ++i) {
+			p.fd = i->second.fd;
+			p.events = (i->second.readclosed || backlogged(i->second) ? 0 : POLLIN) | (i->second.output.empty() ? 0 : POLLOUT);
+			fds.push_back(p);
+			ids.push_back(i->first);
+		}
+		if (poll(&fds[0], fds.size(), -1) < 0 && errno != EINTR) {
+			break;
+		}
+		if (fds[0].revents & POLLIN) {
+			collect_responses();
+		}
+		if (fds[1].revents & POLLIN) {
+			accept_connections();
+		}
+		for (size_t i = 2; i < fds.size(); i++) {
+			std::map<unsigned long, connection>::iterator c = connections.find(ids[i - 2]);
+			bool open = true;
+			if (fds[i].revents & POLLIN) {
+				open = read_connection(c->second);
+			}
+			else if (fds[i].revents & (POLLHUP | POLLERR)) {
+				// The peer is gone for good, nothing more can be delivered
+				open = false;
+			}
+			// Also covers responses that arrived while polling
+			if (open && !c->second.output.empty()) {
+				open = write_connection(c->second);
+			}
+			// Also picks up requests held back while it was backlogged
+			if (open && !c->second.input.empty()) {
+				open = queue_requests(c->first, c->second);
+			}
+			// A half-closed client is done once it has every response
+			if (open && c->second.readclosed && c->second.pendingrequests == 0 && c->second.output.empty()) {
+				open = false;
+			}
+			if (!open) {
+				close(c->second.fd);
+				connections.erase(c);
+			}
+		}
+	}
+
+	stopping.store(true);
+	{
+		lock_guard<mutex> lock(jobmutex);
+		jobready.notify_all();
+	}
+	for (size_t i = 0; i < matchers.size(); i++) {
+		matchers[i].join();
+	}
+}
+
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "gis_map.h"
+#include "gis_trajectory.h"
+
+using namespace std;
+
+// Most samples a matcher thread takes in one batch
+#define GIS_SERVER_BATCH_SAMPLES 512
+// Longest a busy server holds a batch open for more requests to join
+#define GIS_SERVER_BATCH_DELAY_US 200
+#define GIS_SERVER_READ_CHUNK 65536
+// A connection is not read from while it has this much work outstanding
+#define GIS_SERVER_MAX_PENDING_REQUESTS 1024
+#define GIS_SERVER_MAX_PENDING_SAMPLES 65536
+#define GIS_SERVER_MAX_PENDING_OUTPUT (4 << 20)
+
+/**
+ * class gis_server
+ * Map-matching daemon on a Unix domain socket (POSIX only).  The map and
+ * its index are loaded once by the caller and shared by every request.
+ *
+ * One I/O thread polls the listening socket and all client connections and
+ * decodes request frames (see gis_protocol.h) into jobs.  Matcher threads
+ * take jobs off a shared queue in batches, coalescing small requests from
+ * any number of connections, and match each batch against a single map
+ * snapshot.  A lone request is dispatched at once.  Only while requests
+ * queue up faster than the matchers take them, and no matcher is idle,
+ * does a thread hold its batch open for up to GIS_SERVER_BATCH_DELAY_US
+ * or until it reaches GIS_SERVER_BATCH_SAMPLES samples.  Encoded responses go back
+ * to the I/O thread, which writes them as the sockets accept them, so a
+ * client may keep several requests in flight on one connection.
+ *
+ * A connection that has too many requests being matched or too much
+ * unsent output (see GIS_SERVER_MAX_PENDING_*) is not read from until it
+ * drops back under the limits, so a client that sends faster than it
+ * reads is throttled by its own socket buffers.  A client may shut down
+ * its sending side once it has sent its last request: the connection is
+ * closed only after every response has been written.
+ */
+class gis_server {
+public:
+	gis_server(const gis_map &map);
+	~gis_server(void);
+	// Bind and listen on path, replacing a stale socket (but nothing else)
+	bool listen(const char * path);
+	// Serve until stop() is called
+	void run(unsigned int threads);
+	// May be called from any thread or from a signal handler
+	void stop(void);
+	// Requests and samples matched so far
+	unsigned long requests(void) const;
+	unsigned long samples(void) const;
+private:
+	struct job {
+		unsigned long connection;
+		unsigned int requestid;
+		chrono::steady_clock::time_point arrival;
+		gis_trajectory trajectory;
+	};
+	struct connection {
+		int fd;
+		vector<char> input;
+		vector<char> output;
+		size_t sent;
+		// Requests and samples queued or being matched
+		size_t pendingrequests;
+		size_t pendingsamples;
+		// The client has shut down its sending side
+		bool readclosed;
+	};
+	struct response {
+		unsigned long connection;
+		size_t samples;
+		vector<char> frame;
+	};
+	gis_server(const gis_server &);
+	gis_server & operator=(const gis_server &);
+	void matcher(void);
+	void accept_connections(void);
+	bool read_connection(connection &c);
+	bool queue_requests(unsigned long id, connection &c);
+	static bool backlogged(const connection &c);
+	bool write_connection(connection &c);
+	void collect_responses(void);
+	void wake(void);
+	const gis_map &map;
+	string path;
+	int listener;
+	int wakepipe[2];
+	atomic<bool> stopping;
+	atomic<unsigned long> matchedrequests;
+	atomic<unsigned long> matchedsamples;
+	// Owned by the I/O thread
+	std::map<unsigned long, connection> connections;
+	unsigned long nextconnection;
+	// Queued jobs, and finished ones kept for reuse
+	mutex jobmutex;
+	condition_variable jobready;
+	deque<job *> jobs;
+	vector<job *> freejobs;
+	size_t queuedsamples;
+	// Matcher threads waiting for a job
+	unsigned int idlematchers;
+	// Encoded responses waiting for the I/O thread
+	mutex responsemutex;
+	vector<response> responses;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#include "gis_trajectory.h"
+
+gis_trajectory::gis_trajectory(void) {
+}
+
+gis_trajectory::~gis_trajectory(void) {
+}
+
+void gis_trajectory::clear(void) {
+	time.clear();
+	latitude.clear();
+	longitude.clear();
+	edgeid.clear();
+	confidence.clear();
+}
+
+size_t gis_trajectory::size(void) const {
+	return time.size();
+}
+
+void gis_trajectory::resize_results(void) {
+	edgeid.resize(time.size());
+	confidence.resize(time.size());
+}
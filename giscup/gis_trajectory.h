@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * struct gis_trajectory
+ * One trip, stored column-wise: sample i is (time[i], latitude[i],
+ * longitude[i]) and is matched to edgeid[i] with confidence[i].  clear()
+ * keeps the capacity of every column, so one trajectory can be reused for
+ * trip after trip without reallocating.
+ */
+struct gis_trajectory {
+public:
+	gis_trajectory(void);
+	~gis_trajectory(void);
+	void clear(void);
+	// Number of samples
+	size_t size(void) const;
+	// Size the result columns to match the samples
+	void resize_results(void);
+	vector<unsigned int> time;
+	vector<double> latitude;
+	vector<double> longitude;
+	vector<unsigned int> edgeid;
+	vector<double> confidence;
+};
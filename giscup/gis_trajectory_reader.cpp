@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gis_trajectory_reader.h"
+
+// Exactly representable powers of ten, for scaling parsed decimals
+static const double gis_power10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Maximum digits for which the mantissa is exact in a double
+#define GIS_PARSE_MAX_DIGITS 15
+
+inline const char * skip_blanks(const char * p, const char * end) {
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	return p;
+}
+
+/**
+ * Parse an unsigned integer at p.  Returns the position after it, or 0 if
+ * there were no digits.
+ */
+inline const char * parse_unsigned(const char * p, const char * end, unsigned int &value) {
+	const char * start = p;
+	unsigned int v = 0;
+	while (p < end && (unsigned)(*p - '0') < 10) {
+		v = v * 10 + (*p - '0');
+		p++;
+	}
+	value = v;
+	return p == start ? 0 : p;
+}
+
+/**
+ * Parse a decimal number at p.  Returns the position after it, or 0 if there
+ * were no digits.  Up to GIS_PARSE_MAX_DIGITS digits the mantissa is
+ * accumulated as an integer and divided by an exact power of ten, which
+ * rounds once and so matches atof.  Anything longer (or with an exponent)
+ * is handed to strtod.
+ */
+inline const char * parse_double(const char * p, const char * end, double &value) {
+	const char * start = p;
+	unsigned long long mantissa = 0;
+	int digits = 0, decimals = 0;
+	bool negative = false, fraction = false;
+
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+	for (; p < end; p++) {
+		if ((unsigned)(*p - '0') < 10) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits++;
+			if (fraction) {
+				decimals++;
+			}
+		}
+		else if (*p == '.' && !fraction) {
+			fraction = true;
+		}
+		else {
+			break;
+		}
+	}
+	if (digits == 0) {
+		return 0;
+	}
+	if (digits > GIS_PARSE_MAX_DIGITS || (p < end && (*p == 'e' || *p == 'E'))) {
+		char number[64];
+		char * stop;
+		size_t length = 0;
+		while (start + length < end && length < sizeof(number) - 1 && strchr("+-.0123456789eE", start[length]) != 0) {
+			length++;
+		}
+		memcpy(number, start, length);
+		number[length] = 0;
+		value = strtod(number, &stop);
+		return start + (stop - number);
+	}
+	value = (double)mantissa / gis_power10[decimals];
+	if (negative) {
+		value = -value;
+	}
+	return p;
+}
+
+gis_trajectory_reader::gis_trajectory_reader(void) {
+}
+
+gis_trajectory_reader::~gis_trajectory_reader(void) {
+}
+
+bool gis_trajectory_reader::read(const char * filename, gis_trajectory &trajectory) {
+	trajectory.clear();
+	if (!file.open(filename)) {
+		return false;
+	}
+	parse(file.data(), file.data() + file.size(), trajectory);
+	file.close();
+	return true;
+}
+
+void gis_trajectory_reader::parse(const char * begin, const char * end, gis_trajectory &trajectory) {
+	const char * p = begin;
+	while (p < end) {
+		const char * next;
+		unsigned int time;
+		double latitude, longitude;
+
+		// Fields are separated by a comma and optional blanks
+		next = parse_unsigned(skip_blanks(p, end), end, time);
+		if (next != 0) {
+			next = skip_blanks(next, end);
+			if (next < end && *next == ',') {
+				next = parse_double(skip_blanks(next + 1, end), end, latitude);
+			}
+			else {
+				next = 0;
+			}
+		}
+		if (next != 0) {
+			next = skip_blanks(next, end);
+			if (next < end && *next == ',') {
+				next = parse_double(skip_blanks(next + 1, end), end, longitude);
+			}
+			else {
+				next = 0;
+			}
+		}
+		if (next != 0) {
+			trajectory.time.push_back(time);
+			trajectory.latitude.push_back(latitude);
+			trajectory.longitude.push_back(longitude);
+			p = next;
+		}
+		// On to the next line (this also skips anything malformed)
+		while (p < end && *p != '\n') {
+			p++;
+		}
+		p++;
+	}
+}
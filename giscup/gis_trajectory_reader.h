@@ -0,0 +1,23 @@
+#pragma once
+
+#include "gis_trajectory.h"
+#include "gis_mapped_file.h"
+
+/**
+ * class gis_trajectory_reader
+ * Reads contest input files (one "time,latitude,longitude" sample per line)
+ * into a gis_trajectory.  The file is memory mapped and the numbers are
+ * parsed straight out of the mapping, without copying lines or fields.
+ * Lines that do not hold three numbers are skipped.
+ */
+class gis_trajectory_reader {
+public:
+	gis_trajectory_reader(void);
+	~gis_trajectory_reader(void);
+	// Replace the contents of trajectory with the samples of the file
+	bool read(const char * filename, gis_trajectory &trajectory);
+	// Parse samples from a buffer that is already in memory
+	static void parse(const char * begin, const char * end, gis_trajectory &trajectory);
+private:
+	gis_mapped_file file;
+};
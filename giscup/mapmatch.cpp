@@ -5,10 +5,24 @@
 #include <sstream>
 #include <vector>
 #include <time.h>
+#include <stdio.h>
+#include <future>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
 
 #include "gis_map.h"
 #include "gis_node.h"
 #include "gis_segment.h"
+#include "gis_parse.h"
+#include "gis_trajectory.h"
+#include "gis_trajectory_reader.h"
+#include "gis_result_writer.h"
+#include "gis_matcher.h"
+#include "gis_server.h"
 
 using namespace std;
 
@@ -16,8 +30,7 @@ void parse_nodes(char * directory, vector<gis_node> &node) {
 	string filename;
 	unsigned int index, id;
 	double latitude, longitude;
-	filename = directory;
-	filename += "\\WA_Nodes.txt";
+	filename = gis_path_join(directory, "WA_Nodes.txt");
 	ifstream nodefile(filename);
 	index = 0;
 	while (nodefile >> id >> latitude >> longitude) {
@@ -41,8 +54,7 @@ unsigned long parse_edge_geometry(char * directory, vector<gis_segment> &segment
 	bool first;
 	char trash;
 
-	filename = directory;
-	filename += "\\WA_EdgeGeometry.txt";
+	filename = gis_path_join(directory, "WA_EdgeGeometry.txt");
 	ifstream segmentfile(filename);
 	index = 0;
 
@@ -91,8 +103,7 @@ unsigned long parse_edge_geometry2(char * directory, vector<gis_segment> &segmen
 	size_t begin, end;
 	bool first;
 
-	filename = directory;
-	filename += "\\WA_EdgeGeometry.txt";
+	filename = gis_path_join(directory, "WA_EdgeGeometry.txt");
 	ifstream segmentfile(filename);
 	index = 0;
 
@@ -135,83 +146,134 @@ unsigned long parse_edge_geometry2(char * directory, vector<gis_segment> &segmen
 	return index;
 }
 
-int copy_until(const char * haystack, char needle, char * target, int start) {
-	int index = start, i = 0;
-	while (haystack[index] != needle && haystack[index] != 0) {
-		target[i] = haystack[index];
-		i++;
-		index++;
-	}
-	target[i] = 0;
-	if (index == start) {
-		return -1;
-	}
-	if (haystack[index] == needle) {
-		i++;
-	}
-	return i;
+string numbered_filename(const string &directory, const char * format, unsigned int number) {
+	char name[64];
+	sprintf(name, format, number);
+	return gis_path_join(directory, name);
 }
 
-unsigned long parse_edge_geometry3(char * directory, vector<gis_segment> &segment) {
-	string filename;
-	unsigned int index, edgeid;
-	double lat1, lon1, lat2, lon2;
-	int begin, count;
-	bool first;
-	char *line, string1[25];
-	line = new char[1048576];
+bool read_input(gis_trajectory_reader &reader, const string &inputdirectory, unsigned int n, gis_trajectory &trajectory) {
+	return reader.read(numbered_filename(inputdirectory, "input_%02u.txt", n).c_str(), trajectory);
+}
 
-	filename = directory;
-	filename += "\\WA_EdgeGeometry.txt";
-	ifstream segmentfile(filename);
-	index = 0;
+/**
+ * Match every GisContestTrainingData/input/input_NN.txt (NN counting up
+ * from 01 until a file is missing) and write output_NN.txt files into
+ * outputdirectory.  While one trip is matched the next input file is read
+ * and parsed on another thread into the second of two reused trajectories.
+ * Returns the number of trips matched.
+ */
+unsigned int match_training_inputs(char * directory, char * outputdirectory, const gis_map &map) {
+	gis_trajectory trajectory[2];
+	gis_trajectory_reader reader[2];
+	gis_result_writer writer;
+	vector<unsigned int> candidates;
+	string inputdirectory = gis_path_join(directory, "GisContestTrainingData/input");
+	future<bool> next;
+	unsigned int n;
 
-	while (segmentfile.getline(line, 1048576)) {
-		// get the edge id
-		edgeid = atol(line);
-		int j = 0;
-		for (int i = 0; i < 4;) {
-			if (line[j] == '^') {
-				i++;
-				begin = j;
-			}
-			j++;
+	next = async(launch::async, read_input, ref(reader[1]), cref(inputdirectory), 1, ref(trajectory[1]));
+	for (n = 1; next.get(); n++) {
+		gis_trajectory &current = trajectory[n & 1];
+		// Prefetch the next trip while this one is matched
+		next = async(launch::async, read_input, ref(reader[(n + 1) & 1]), cref(inputdirectory), n + 1, ref(trajectory[(n + 1) & 1]));
+		{
+			gis_map::snapshot snapshot(map);
+			gis_match_nearest(snapshot, current, candidates);
 		}
-		first = true;
-		while ((count = copy_until(line, '^', string1, begin + 1)) != -1) {
-			begin += count;
-			lat2 = atof(string1);
-			count = copy_until(line, '^', string1, begin + 1);
-			begin += count;
-			lon2 = atof(string1);
-			if (first) {
-				first = false;
-			}
-			else {
-				if (index >= segment.size()) {
-					segment.resize(index + 1);
-				}
-				segment[index].edgeid = edgeid;
-				segment[index].latitude1 = lat1;
-				segment[index].longitude1 = lon1;
-				segment[index].latitude2 = lat2;
-				segment[index].longitude2 = lon2;
-
-				index++;
-			}
-			lat1 = lat2;
-			lon1 = lon2;
+		bool written = writer.open(numbered_filename(outputdirectory, "output_%02u.txt", n).c_str());
+		if (written) {
+			writer.write(current);
+			// A full disk only shows up once the last block is flushed
+			written = writer.close();
+		}
+		if (!written) {
+			cout << "Could not write output " << n << endl;
 		}
 	}
-	delete [] line;
-	segmentfile.close();
-	return index;
+	return n - 1;
+}
+
+#ifndef _WIN32
+gis_server * running_server = 0;
+
+void stop_server(int) {
+	if (running_server != 0) {
+		running_server->stop();
+	}
+}
+
+/**
+ * Daemon mode: serve match requests on a Unix domain socket until SIGINT or
+ * SIGTERM.  Returns the process exit code.
+ */
+int serve(const gis_map &map, unsigned long segments, const char * path, unsigned int threads) {
+	gis_server server(map);
+	if (segments == 0) {
+		// Every sample would come back unmatched
+		cout << "No segments loaded, not serving" << endl;
+		return 1;
+	}
+	if (threads == 0) {
+		threads = 1;
+	}
+	if (!server.listen(path)) {
+		cout << "Could not listen on " << path << endl;
+		return 1;
+	}
+	running_server = &server;
+	signal(SIGINT, stop_server);
+	signal(SIGTERM, stop_server);
+	cout << "Serving on " << path << " with " << threads << " matcher threads" << endl;
+	server.run(threads);
+	running_server = 0;
+	cout << "Requests matched: " << server.requests() << endl;
+	cout << "Samples matched: " << server.samples() << endl;
+	return 0;
+}
+#endif
+
+void print_usage(void) {
+	cout << "Usage: mapmatch <path to giscup_data> [output directory]" << endl;
+#ifndef _WIN32
+	cout << "       mapmatch <path to giscup_data> --serve <socket path> [matcher threads, 1 to " << GIS_EPOCH_MAX_READERS << "]" << endl;
+#endif
 }
 
 int main(int argc, char *argv[]) {
 
 	unsigned long count;
 	clock_t begin, end;
+	bool serving = false;
+	long threads = 0;
+
+	// Check the arguments before spending time on loading the network
+	if (argc < 2) {
+		print_usage();
+		return 1;
+	}
+	if (argc > 2 && strcmp(argv[2], "--serve") == 0) {
+#ifdef _WIN32
+		cout << "--serve needs Unix domain sockets and is not available on this platform" << endl;
+		return 1;
+#else
+		serving = true;
+		threads = min(max((long)thread::hardware_concurrency(), 1L), (long)GIS_EPOCH_MAX_READERS);
+		if (argc < 4 || argc > 5) {
+			print_usage();
+			return 1;
+		}
+		if (argc == 5) {
+			char * last;
+			threads = strtol(argv[4], &last, 10);
+			// Each matcher thread holds one map snapshot while it works
+			if (last == argv[4] || *last != 0 || threads < 1 || threads > GIS_EPOCH_MAX_READERS) {
+				print_usage();
+				return 1;
+			}
+		}
+#endif
+	}
 
 	/*
 	begin = clock();
@@ -251,8 +313,21 @@ int main(int argc, char *argv[]) {
 
 	gis_map map;
 
-	for (unsigned int i = 0; i < segment3.size(); i++) {
-		map.add_segment(segment3[i].edgeid, segment3[i].latitude1, segment3[i].longitude1, segment3[i].latitude2, segment3[i].longitude2);
+	map.add_segments(segment3);
+
+#ifndef _WIN32
+	if (serving) {
+		return serve(map, count, argv[3], (unsigned int)threads);
+	}
+#endif
+
+	if (argc > 2) {
+		begin = clock();
+		cout << "Matching Trajectories" << endl;
+		count = match_training_inputs(argv[1], argv[2], map);
+		cout << "Trajectories Matched: " << count << endl;
+		end = clock();
+		cout << setprecision(15) << (double(end - begin) / CLOCKS_PER_SEC) << endl;;
 	}
 
 	system("pause");